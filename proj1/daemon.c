@@ -0,0 +1,457 @@
+/*
+ * File:          daemon.c
+ * Date:          05. 11. 2017
+ * Author:        Dominik Vecera, xvecer23@stud.fit.vutbr.cz
+ * Project:       Working with text
+ * Description:   Daemon answering prefixes over a Unix domain socket, see daemon.h.
+ */
+
+#define _POSIX_C_SOURCE 200809L // sockets, sigwait, rwlocks
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "daemon.h"
+#include "reader.h"
+
+#define DAEMON_BLOCK 4096            // bytes read from a client at once
+#define DAEMON_MAX_UNREAD (1 << 20)  // a client with more unread answers is not read until it takes them
+
+// Connection of a client. Its prefixes are answered one at a time, so the answers keep their order.
+typedef struct {
+  int fd;
+  char *in;         // received bytes which have not been answered yet
+  size_t in_len, in_cap;
+  char *out;        // answers which have not been sent yet, from out_sent
+  size_t out_len, out_sent, out_cap;
+  bool busy;        // a worker is answering the first line of in
+  bool eof;         // the client will send no more prefixes
+  bool dead;        // the connection failed, it is closed when the worker is done with it
+} client;
+
+// Prefix of a client handed to a worker, together with its answer.
+typedef struct job {
+  client *c;
+  char *prefix;     // a copy of the line, followed by READER_PAD zero bytes
+  size_t len;
+  char *answer;     // the formatted answer (NULL if there was not enough memory)
+  size_t answer_len;
+  struct job *next;
+} job;
+
+// State shared by the threads of the daemon.
+typedef struct {
+  int listen_fd;
+  int wake[2];            // pipe by which the workers wake up the poller when an answer is done
+  trie *current;          // the loaded database, replaced on reload
+  pthread_rwlock_t lock;  // read by the queries, written by the reload
+  daemon_answer answer;
+  pthread_mutex_t jobs_lock;
+  pthread_cond_t jobs_ready;
+  job *todo, *todo_last;  // prefixes waiting for a worker
+  job *done;              // answers waiting for the poller
+  pthread_t main_thread;  // the thread waiting for the signals
+  bool failed;            // the poller stopped because of an error, guarded by jobs_lock
+} daemon_state;
+
+// Function which makes sure that a buffer has space for needed bytes.
+static bool reserve_bytes(char **buf, size_t *cap, size_t needed)
+{
+  if (needed <= *cap)
+    return true;
+
+  size_t new_cap = *cap ? *cap : DAEMON_BLOCK;
+  while (new_cap < needed)
+    new_cap *= 2;
+  char *new_buf = realloc(*buf, new_cap);
+  if (new_buf == NULL)
+    return false;
+  *buf = new_buf;
+  *cap = new_cap;
+  return true;
+}
+
+/* Function which formats the answer of a job. Only the formatting into memory holds the lock of the database,
+   so a reload never waits for a client which reads its answers slowly. */
+static void answer_job(daemon_state *d, job *j)
+{
+  FILE *out = open_memstream(&j->answer, &j->answer_len);
+
+  if (out == NULL){
+    j->answer = NULL;
+    return;
+  }
+  pthread_rwlock_rdlock(&d->lock);
+  d->answer(out, d->current, j->prefix, j->len);
+  pthread_rwlock_unlock(&d->lock);
+  fputc('\n', out);
+  if (fclose(out) == EOF){
+    free(j->answer);
+    j->answer = NULL;
+  }
+}
+
+// Function of a thread of the pool, it answers the prefixes of all clients one by one.
+static void *worker(void *arg)
+{
+  daemon_state *d = arg;
+
+  while (true){
+    pthread_mutex_lock(&d->jobs_lock);
+    while (d->todo == NULL)
+      pthread_cond_wait(&d->jobs_ready, &d->jobs_lock);
+    job *j = d->todo;
+    d->todo = j->next;
+    pthread_mutex_unlock(&d->jobs_lock);
+
+    answer_job(d, j);
+
+    pthread_mutex_lock(&d->jobs_lock);
+    j->next = d->done;
+    d->done = j;
+    pthread_mutex_unlock(&d->jobs_lock);
+    while (write(d->wake[1], "", 1) == -1 && errno == EINTR)
+      ;
+  }
+  return NULL;
+}
+
+// Function which hands the first line of a client to the workers, returns false if there is not enough memory.
+static bool start_job(daemon_state *d, client *c)
+{
+  char *nl = memchr(c->in, '\n', c->in_len);
+  size_t len = (nl != NULL) ? (size_t)(nl - c->in) : c->in_len; // the last line may miss the newline
+  job *j = malloc(sizeof(job));
+  char *prefix = malloc(len + READER_PAD);
+
+  if (j == NULL || prefix == NULL){
+    free(j);
+    free(prefix);
+    return false;
+  }
+  memcpy(prefix, c->in, len);
+  memset(prefix + len, 0, READER_PAD);
+  size_t used = (nl != NULL) ? len + 1 : len;
+  memmove(c->in, c->in + used, c->in_len - used);
+  c->in_len -= used;
+
+  *j = (job){c, prefix, len, NULL, 0, NULL};
+  c->busy = true;
+  pthread_mutex_lock(&d->jobs_lock);
+  if (d->todo == NULL)
+    d->todo = j;
+  else
+    d->todo_last->next = j;
+  d->todo_last = j;
+  pthread_cond_signal(&d->jobs_ready);
+  pthread_mutex_unlock(&d->jobs_lock);
+  return true;
+}
+
+// Function which takes the answers done by the workers and queues them for sending to their clients.
+static void finish_jobs(daemon_state *d)
+{
+  char drain[64];
+  while (read(d->wake[0], drain, sizeof(drain)) > 0)
+    ;
+
+  pthread_mutex_lock(&d->jobs_lock);
+  job *j = d->done;
+  d->done = NULL;
+  pthread_mutex_unlock(&d->jobs_lock);
+
+  while (j != NULL){
+    job *next = j->next;
+    client *c = j->c;
+    c->busy = false;
+    if (j->answer == NULL || !reserve_bytes(&c->out, &c->out_cap, c->out_len + j->answer_len))
+      c->dead = true;
+    else if (!c->dead){
+      memcpy(c->out + c->out_len, j->answer, j->answer_len);
+      c->out_len += j->answer_len;
+    }
+    free(j->answer);
+    free(j->prefix);
+    free(j);
+    j = next;
+  }
+}
+
+// Function which reads what a client has sent, without blocking.
+static void receive(client *c)
+{
+  while (!c->dead && !c->eof){
+    if (!reserve_bytes(&c->in, &c->in_cap, c->in_len + DAEMON_BLOCK)){
+      c->dead = true;
+      break;
+    }
+    ssize_t n = read(c->fd, c->in + c->in_len, c->in_cap - c->in_len);
+    if (n > 0)
+      c->in_len += n;
+    else if (n == 0)
+      c->eof = true;
+    else if (errno == EAGAIN || errno == EWOULDBLOCK)
+      break;
+    else if (errno != EINTR)
+      c->dead = true;
+  }
+}
+
+// Function which sends the queued answers of a client, as much as it takes without blocking.
+static void send_answers(client *c)
+{
+  while (!c->dead && c->out_sent < c->out_len){
+    ssize_t n = write(c->fd, c->out + c->out_sent, c->out_len - c->out_sent);
+    if (n > 0)
+      c->out_sent += n;
+    else if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+      return;
+    else if (n == -1 && errno != EINTR)
+      c->dead = true; // the client is gone
+  }
+  c->out_len = c->out_sent = 0;
+}
+
+// Function which stops the daemon after the poller failed, it wakes up the main thread waiting for the signals.
+static void *poller_failed(daemon_state *d)
+{
+  pthread_mutex_lock(&d->jobs_lock);
+  d->failed = true;
+  pthread_mutex_unlock(&d->jobs_lock);
+  pthread_kill(d->main_thread, SIGTERM);
+  return NULL;
+}
+
+// Function which sets a descriptor not to block.
+static bool set_nonblocking(int fd)
+{
+  int flags = fcntl(fd, F_GETFL);
+  return flags != -1 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) != -1;
+}
+
+/* Function of the thread which does all input and output of the clients with poll(), so any number of
+   idle clients can stay connected. A complete line of a client which is not busy is handed to the
+   workers, and reading stops while a client has too many answers it has not read yet. */
+static void *poller(void *arg)
+{
+  daemon_state *d = arg;
+  client **clients = NULL;
+  struct pollfd *fds = NULL;
+  size_t count = 0, cap = 0;
+
+  while (true){
+    if (count + 2 > cap){
+      size_t new_cap = cap ? cap * 2 : 16;
+      client **new_clients = realloc(clients, new_cap * sizeof(client *));
+      if (new_clients != NULL)
+        clients = new_clients;
+      struct pollfd *new_fds = realloc(fds, (new_cap + 2) * sizeof(struct pollfd));
+      if (new_fds != NULL)
+        fds = new_fds;
+      if (new_clients == NULL || new_fds == NULL){
+        fprintf(stderr, "Not enough memory for the clients of the daemon.\n");
+        return poller_failed(d);
+      }
+      cap = new_cap;
+    }
+
+    fds[0] = (struct pollfd){d->listen_fd, POLLIN, 0};
+    fds[1] = (struct pollfd){d->wake[0], POLLIN, 0};
+    for (size_t i = 0; i < count; i++){
+      client *c = clients[i];
+      short events = (c->out_sent < c->out_len) ? POLLOUT : 0;
+      if (!c->eof && c->out_len - c->out_sent < DAEMON_MAX_UNREAD)
+        events |= POLLIN;
+      fds[i + 2] = (struct pollfd){c->dead ? -1 : c->fd, events, 0}; // a failed client waits only for its worker
+    }
+    if (poll(fds, count + 2, -1) == -1){
+      if (errno == EINTR)
+        continue;
+      fprintf(stderr, "The daemon cannot wait for the clients: %s\n", strerror(errno));
+      return poller_failed(d);
+    }
+
+    if (fds[1].revents & POLLIN)
+      finish_jobs(d);
+    for (size_t i = 0; i < count; i++){
+      client *c = clients[i];
+      if (fds[i + 2].revents & (POLLIN | POLLHUP | POLLERR))
+        receive(c);
+      send_answers(c);
+      if (!c->busy && !c->dead && c->out_len - c->out_sent < DAEMON_MAX_UNREAD
+          && (memchr(c->in, '\n', c->in_len) != NULL || (c->eof && c->in_len > 0)) && !start_job(d, c))
+        c->dead = true;
+    }
+
+    // A client is closed when it failed or when everything it sent has been answered and sent to it.
+    size_t kept = 0;
+    for (size_t i = 0; i < count; i++){
+      client *c = clients[i];
+      if (!c->busy && (c->dead || (c->eof && c->in_len == 0 && c->out_sent == c->out_len))){
+        close(c->fd);
+        free(c->in);
+        free(c->out);
+        free(c);
+      }
+      else
+        clients[kept++] = c;
+    }
+    count = kept;
+
+    // New clients are taken last, the arrays have space for one more and more are accepted in the next round.
+    if (fds[0].revents & POLLIN){
+      int fd = accept(d->listen_fd, NULL, NULL);
+      client *c = (fd != -1) ? calloc(1, sizeof(client)) : NULL;
+      if (c == NULL || !set_nonblocking(fd)){
+        if (fd != -1)
+          close(fd);
+        free(c);
+      }
+      else {
+        c->fd = fd;
+        clients[count++] = c;
+      }
+    }
+  }
+}
+
+/* Function which creates the listening socket. An old socket left at the path is removed, but only if nobody
+   accepts connections on it, so a running daemon keeps its socket. */
+static int open_socket(const char *path)
+{
+  struct sockaddr_un addr;
+  struct stat st;
+
+  if (strlen(path) >= sizeof(addr.sun_path)){
+    fprintf(stderr, "The socket path %s is too long.\n", path);
+    return -1;
+  }
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+
+  if (stat(path, &st) == 0 && S_ISSOCK(st.st_mode)){
+    int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+    bool running = probe != -1 && connect(probe, (struct sockaddr *)&addr, sizeof(addr)) == 0;
+    bool stale = probe != -1 && !running && errno == ECONNREFUSED;
+    if (probe != -1)
+      close(probe);
+    if (running){
+      fprintf(stderr, "The socket %s is used by a running daemon.\n", path);
+      return -1;
+    }
+    if (stale)
+      unlink(path);
+  }
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd == -1 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1 || listen(fd, 16) == -1){
+    fprintf(stderr, "The socket %s could not be opened: %s\n", path, strerror(errno));
+    if (fd != -1)
+      close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// Function which loads a new trie, prints an error message and returns NULL on failure.
+static trie *load_trie(const char *db_path, daemon_load load)
+{
+  trie *t = malloc(sizeof(trie));
+
+  if (t == NULL || !load(t, db_path)){
+    fprintf(stderr, "The database %s could not be loaded.\n", db_path);
+    free(t);
+    return NULL;
+  }
+  return t;
+}
+
+// Function which runs the daemon on the socket socket_path until it is stopped by a signal, returns the exit code.
+int daemon_run(const char *socket_path, const char *db_path, daemon_load load, daemon_answer answer)
+{
+  daemon_state d;
+  pthread_t ids[DAEMON_WORKERS + 1]; // the poller and the workers
+  sigset_t signals;
+  int sig;
+
+  /* The signals are blocked in all threads and taken by sigwait() in this one, so a reload runs as normal
+     code and not in a signal handler. A client closing its connection must not kill the daemon. */
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGHUP);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, NULL);
+  signal(SIGPIPE, SIG_IGN);
+
+  if ((d.current = load_trie(db_path, load)) == NULL)
+    return 1;
+  if ((d.listen_fd = open_socket(socket_path)) == -1){
+    trie_free(d.current);
+    free(d.current);
+    return 1;
+  }
+  pthread_rwlock_init(&d.lock, NULL);
+  pthread_mutex_init(&d.jobs_lock, NULL);
+  pthread_cond_init(&d.jobs_ready, NULL);
+  d.answer = answer;
+  d.todo = d.todo_last = d.done = NULL;
+  d.main_thread = pthread_self();
+  d.failed = false;
+
+  unsigned started = 0;
+  if (pipe(d.wake) == -1 || !set_nonblocking(d.wake[0]) || !set_nonblocking(d.wake[1])
+      || !set_nonblocking(d.listen_fd))
+    fprintf(stderr, "The daemon could not be started: %s\n", strerror(errno));
+  else if (pthread_create(&ids[0], NULL, poller, &d) == 0){
+    for (started = 1; started <= DAEMON_WORKERS; started++)
+      if (pthread_create(&ids[started], NULL, worker, &d) != 0)
+        break;
+    if (started == 1)
+      fprintf(stderr, "No worker of the daemon could be started.\n");
+  }
+  else
+    fprintf(stderr, "No thread of the daemon could be started.\n");
+  if (started <= 1){
+    started = 0;
+    sig = SIGTERM;
+  }
+  else
+    fprintf(stderr, "Listening on %s.\n", socket_path);
+
+  while (started > 0 && sigwait(&signals, &sig) == 0 && sig == SIGHUP){
+    // The new database is loaded while the queries still use the old one, then they are swapped.
+    trie *t = load_trie(db_path, load);
+    if (t == NULL){
+      fprintf(stderr, "The old database is kept.\n");
+      continue;
+    }
+    pthread_rwlock_wrlock(&d.lock);
+    trie *old = d.current;
+    d.current = t;
+    pthread_rwlock_unlock(&d.lock);
+    trie_free(old);
+    free(old);
+    fprintf(stderr, "The database %s was reloaded.\n", db_path);
+  }
+
+  pthread_mutex_lock(&d.jobs_lock);
+  bool failed = started == 0 || d.failed;
+  pthread_mutex_unlock(&d.jobs_lock);
+  if (started > 0 && failed) // the poller has returned
+    pthread_join(ids[0], NULL);
+
+  /* The workers may be in the middle of a query, so the trie is left to the end of the process
+     and only the socket is removed. */
+  close(d.listen_fd);
+  unlink(socket_path);
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,33 @@
+/*
+ * File:          daemon.h
+ * Date:          05. 11. 2017
+ * Author:        Dominik Vecera, xvecer23@stud.fit.vutbr.cz
+ * Project:       Working with text
+ * Description:   Daemon answering prefixes over a Unix domain socket with the index kept in memory.
+ *                A client sends one prefix per line and gets the same answer as from the batch mode,
+ *                followed by an empty line. One thread waits for all clients with poll() and hands their
+ *                prefixes one at a time to a small pool of threads, so idle clients do not hold a thread.
+ *                SIGHUP reloads the database (queries keep using the old one until the new one is ready)
+ *                and SIGINT or SIGTERM stop the daemon.
+ */
+
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "index.h"
+
+#define DAEMON_WORKERS 4 // number of threads answering the prefixes
+
+// Function which loads the database from a file (a database or an index file) into a trie.
+typedef bool (*daemon_load)(trie *t, const char *path);
+
+// Function which prints the answer for a prefix of length len (in bytes).
+typedef void (*daemon_answer)(FILE *out, const trie *t, const char *prefix, size_t len);
+
+// Function which runs the daemon on the socket socket_path until it is stopped by a signal, returns the exit code.
+int daemon_run(const char *socket_path, const char *db_path, daemon_load load, daemon_answer answer);
+
+#endif
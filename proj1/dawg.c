@@ -0,0 +1,584 @@
+/*
+ * File:          dawg.c
+ * Date:          05. 11. 2017
+ * Author:        Dominik Vecera, xvecer23@stud.fit.vutbr.cz
+ * Project:       Working with text
+ * Description:   Minimal acyclic automaton of the city database, see dawg.h.
+ */
+
+#define _POSIX_C_SOURCE 200809L // open, fstat, mmap
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "dawg.h"
+#include "index.h"
+#include "utf8.h"
+
+#define INITIAL_CAPACITY 64
+#define NO_STATE UINT32_MAX // empty slot of the register, or a failed registration
+#define PENDING UINT32_MAX  // target of the last transition of a state on the path, which is not built yet
+
+// State on the path of the last added key, it is moved into the automaton once no other key can change it.
+typedef struct {
+  dawg_trans *trans;
+  uint32_t count;
+  uint32_t cap;
+  bool final;
+} path_state;
+
+// State of the construction of the automaton.
+typedef struct {
+  dawg *d;
+  uint32_t state_cap;
+  uint32_t trans_cap;
+  uint32_t *table;      // register of the states, open addressing by hash_state()
+  uint32_t table_cap;   // a power of 2
+  uint32_t table_count;
+  path_state *path;     // path[i] - state after the first i characters of the last key
+  uint32_t path_cap;
+  uint32_t depth;       // length of the last key
+} dawg_builder;
+
+// Function which makes sure that an array has space for at least needed items.
+static bool grow(void **array, uint32_t *cap, uint64_t needed, size_t item_size)
+{
+  if (needed <= *cap)
+    return true;
+
+  uint64_t new_cap = *cap ? *cap : INITIAL_CAPACITY;
+  while (new_cap < needed)
+    new_cap *= 2;
+  if (new_cap > UINT32_MAX)
+    return false;
+  void *new_array = realloc(*array, new_cap * item_size);
+  if (new_array == NULL)
+    return false;
+
+  *array = new_array;
+  *cap = new_cap;
+  return true;
+}
+
+/* Function which returns the label of a character in a key: the capital letter of the Enable alphabet
+   (with its diacritics) if the character has one, otherwise the folded character. */
+static uint32_t key_label(uint32_t c)
+{
+  int slot = enable_slot(c);
+  size_t i = 0;
+
+  if (slot < 0)
+    return utf8_fold(c);
+  return utf8_next(enable_chars[slot], strlen(enable_chars[slot]), &i);
+}
+
+// Function which initializes an empty automaton to which lines can be added.
+void dawg_init(dawg *d)
+{
+  memset(d, 0, sizeof(*d));
+}
+
+// Function which frees all memory of an automaton.
+void dawg_free(dawg *d)
+{
+  if (d->map != NULL)
+    munmap(d->map, d->map_len);
+  else {
+    free(d->states);
+    free(d->trans);
+    free(d->key_first);
+    free(d->line_off);
+    free(d->line_id);
+    free(d->text);
+  }
+  free(d->keys);
+  free(d->key_off);
+  memset(d, 0, sizeof(*d));
+}
+
+// Function which adds a line of length len (without the newline) of the database.
+bool dawg_add(dawg *d, const char *line, size_t len)
+{
+  uint32_t weight; // the weights are not kept by the automaton
+  len = split_weight(line, len, &weight);
+
+  if (!grow((void **)&d->line_off, &d->line_cap, (uint64_t)d->line_count + 1, sizeof(uint32_t))
+      || !grow((void **)&d->key_off, &d->key_off_cap, (uint64_t)d->line_count + 2, sizeof(uint32_t))
+      || !grow((void **)&d->text, &d->text_cap, (uint64_t)d->text_len + len + 1, 1)
+      || !grow((void **)&d->keys, &d->keys_cap, (uint64_t)d->keys_len + len, sizeof(uint32_t)))
+    return false;
+
+  memcpy(d->text + d->text_len, line, len);
+  d->text[d->text_len + len] = '\0';
+  d->line_off[d->line_count] = d->text_len;
+  d->text_len += len + 1;
+
+  d->key_off[d->line_count++] = d->keys_len;
+  for (size_t i = 0; i < len; )
+    d->keys[d->keys_len++] = key_label(utf8_next(line, len, &i));
+  return true;
+}
+
+// Function which compares the keys of two lines by their characters, then the lines by their order.
+static int key_compar(const dawg *d, uint32_t x, uint32_t y)
+{
+  const uint32_t *kx = d->keys + d->key_off[x], *ky = d->keys + d->key_off[y];
+  uint32_t nx = d->key_off[x+1] - d->key_off[x], ny = d->key_off[y+1] - d->key_off[y];
+
+  for (uint32_t i = 0; i < nx && i < ny; i++)
+    if (kx[i] != ky[i])
+      return kx[i] < ky[i] ? -1 : 1;
+  if (nx != ny)
+    return nx < ny ? -1 : 1;
+  return (x > y) - (x < y);
+}
+
+// Function which compares two lines by their order in the database.
+static int line_id_compar(const dawg *d, uint32_t x, uint32_t y)
+{
+  return (d->line_id[x] > d->line_id[y]) - (d->line_id[x] < d->line_id[y]);
+}
+
+/* Function which sorts n lines by a comparison of lines of an automaton, returns false if there is not enough memory.
+   It is a merge sort (an insertion sort for a few lines) rather than qsort(), whose comparison gets no context
+   and could only find the automaton in a global variable, so dawg_query() of a const automaton stays re-entrant. */
+static bool sort_lines(const dawg *d, uint32_t *lines, uint32_t n, int (*compar)(const dawg *, uint32_t, uint32_t))
+{
+  if (n <= 16){
+    for (uint32_t i = 1; i < n; i++){
+      uint32_t line = lines[i], j = i;
+      for (; j > 0 && compar(d, lines[j-1], line) > 0; j--)
+        lines[j] = lines[j-1];
+      lines[j] = line;
+    }
+    return true;
+  }
+
+  uint32_t *tmp = malloc((size_t)n * sizeof(uint32_t)), *from = lines, *to = tmp;
+  if (tmp == NULL)
+    return false;
+  for (size_t width = 1; width < n; width *= 2){
+    for (size_t left = 0; left < n; left += 2 * width){
+      size_t mid = (left + width < n) ? left + width : n, right = (mid + width < n) ? mid + width : n;
+      size_t i = left, j = mid, k = left;
+      while (i < mid && j < right)
+        to[k++] = (compar(d, from[j], from[i]) < 0) ? from[j++] : from[i++];
+      while (i < mid)
+        to[k++] = from[i++];
+      while (j < right)
+        to[k++] = from[j++];
+    }
+    uint32_t *swap = from;
+    from = to;
+    to = swap;
+  }
+  if (from != lines)
+    memcpy(lines, from, (size_t)n * sizeof(uint32_t));
+  free(tmp);
+  return true;
+}
+
+// Function which computes the hash of a state from its final flag and transitions.
+static uint32_t hash_state(uint32_t count, const dawg_trans *trans, uint32_t n)
+{
+  uint32_t h = 2166136261u ^ count; // FNV-1a over the words
+
+  for (uint32_t i = 0; i < n; i++){
+    h = (h ^ trans[i].label) * 16777619u;
+    h = (h ^ trans[i].target) * 16777619u;
+  }
+  return h;
+}
+
+// Function which doubles the register of the states.
+static bool grow_table(dawg_builder *b)
+{
+  uint32_t cap = b->table_cap ? b->table_cap * 2 : 1024;
+  uint32_t *table = malloc((size_t)cap * sizeof(uint32_t));
+  if (table == NULL)
+    return false;
+
+  memset(table, 0xFF, (size_t)cap * sizeof(uint32_t)); // NO_STATE everywhere
+  for (uint32_t i = 0; i < b->table_cap; i++){
+    uint32_t id = b->table[i];
+    if (id == NO_STATE)
+      continue;
+    const dawg_state *s = &b->d->states[id];
+    uint32_t h = hash_state(s->count, b->d->trans + s->first, s->count & ~DAWG_FINAL) & (cap - 1);
+    while (table[h] != NO_STATE)
+      h = (h + 1) & (cap - 1);
+    table[h] = id;
+  }
+
+  free(b->table);
+  b->table = table;
+  b->table_cap = cap;
+  return true;
+}
+
+/* Function which returns the state of the automaton equal to a state of the path, a new state is added
+   if there is none. Returns NO_STATE if there is not enough memory. */
+static uint32_t register_state(dawg_builder *b, const path_state *p)
+{
+  dawg *d = b->d;
+  uint32_t count = p->count | (p->final ? DAWG_FINAL : 0);
+
+  if (b->table_count * 2 >= b->table_cap && !grow_table(b))
+    return NO_STATE;
+
+  uint32_t h = hash_state(count, p->trans, p->count) & (b->table_cap - 1);
+  for (; b->table[h] != NO_STATE; h = (h + 1) & (b->table_cap - 1)){
+    const dawg_state *s = &d->states[b->table[h]];
+    if (s->count == count
+        && (p->count == 0 || memcmp(d->trans + s->first, p->trans, p->count * sizeof(dawg_trans)) == 0))
+      return b->table[h];
+  }
+
+  if (!grow((void **)&d->states, &b->state_cap, (uint64_t)d->state_count + 1, sizeof(dawg_state))
+      || !grow((void **)&d->trans, &b->trans_cap, (uint64_t)d->trans_count + p->count, sizeof(dawg_trans)))
+    return NO_STATE;
+
+  dawg_state *s = &d->states[d->state_count];
+  s->first = d->trans_count;
+  s->count = count;
+  s->words = p->final ? 1 : 0;
+  for (uint32_t i = 0; i < p->count; i++)
+    s->words += d->states[p->trans[i].target].words;
+  if (p->count > 0) // leaves have no transitions (and maybe no array)
+    memcpy(d->trans + d->trans_count, p->trans, p->count * sizeof(dawg_trans));
+  d->trans_count += p->count;
+
+  b->table[h] = d->state_count;
+  b->table_count++;
+  return d->state_count++;
+}
+
+// Function which moves the states of the path deeper than depth into the automaton.
+static bool minimize(dawg_builder *b, uint32_t depth)
+{
+  while (b->depth > depth){
+    uint32_t id = register_state(b, &b->path[b->depth]);
+    if (id == NO_STATE)
+      return false;
+
+    path_state *parent = &b->path[b->depth - 1];
+    parent->trans[parent->count - 1].target = id;
+    b->path[b->depth].count = 0;
+    b->path[b->depth].final = false;
+    b->depth--;
+  }
+  return true;
+}
+
+/* Function which adds a key to the automaton, keys have to come sorted and without duplicates. The first
+   common characters are shared with the previous key, whose remaining states cannot change any more. */
+static bool add_key(dawg_builder *b, const uint32_t *key, uint32_t n, uint32_t common)
+{
+  if (!minimize(b, common))
+    return false;
+
+  if (n + 1 > b->path_cap){
+    uint32_t old_cap = b->path_cap;
+    if (!grow((void **)&b->path, &b->path_cap, (uint64_t)n + 1, sizeof(path_state)))
+      return false;
+    memset(b->path + old_cap, 0, (b->path_cap - old_cap) * sizeof(path_state));
+  }
+
+  for (uint32_t i = common; i < n; i++){
+    path_state *p = &b->path[b->depth];
+    if (!grow((void **)&p->trans, &p->cap, (uint64_t)p->count + 1, sizeof(dawg_trans)))
+      return false;
+    p->trans[p->count].label = key[i];
+    p->trans[p->count++].target = PENDING;
+    b->depth++;
+  }
+  b->path[b->depth].final = true;
+  return true;
+}
+
+// Function which builds the automaton from the lines in the given order (sorted by their keys).
+static bool build(dawg *d, const uint32_t *order)
+{
+  dawg_builder b;
+  bool ok;
+
+  memset(&b, 0, sizeof(b));
+  b.d = d;
+  ok = grow((void **)&b.path, &b.path_cap, 1, sizeof(path_state));
+  if (ok)
+    memset(b.path, 0, b.path_cap * sizeof(path_state));
+
+  for (uint32_t i = 0; ok && i < d->line_count; i++){
+    const uint32_t *key = d->keys + d->key_off[order[i]];
+    uint32_t n = d->key_off[order[i] + 1] - d->key_off[order[i]];
+    uint32_t common = 0;
+
+    if (i > 0){
+      const uint32_t *prev = d->keys + d->key_off[order[i-1]];
+      uint32_t prev_n = d->key_off[order[i-1] + 1] - d->key_off[order[i-1]];
+      while (common < n && common < prev_n && key[common] == prev[common])
+        common++;
+      if (common == n && common == prev_n){ // the same key as the previous line
+        d->key_first[d->word_count] = i + 1; // only moves the end of the range of the key
+        continue;
+      }
+    }
+
+    d->key_first[d->word_count++] = i;
+    d->key_first[d->word_count] = i + 1;
+    ok = add_key(&b, key, n, common);
+  }
+
+  if (ok && (ok = minimize(&b, 0)))
+    ok = (d->root = register_state(&b, &b.path[0])) != NO_STATE;
+
+  for (uint32_t i = 0; i < b.path_cap; i++)
+    free(b.path[i].trans);
+  free(b.path);
+  free(b.table);
+  return ok;
+}
+
+// Function which sorts the added lines by their keys and builds the minimal automaton of the keys.
+bool dawg_finish(dawg *d)
+{
+  uint32_t n = d->line_count;
+  uint32_t *order = malloc(((size_t)n + 1) * sizeof(uint32_t));
+  uint32_t *line_off = malloc(((size_t)n + 1) * sizeof(uint32_t));
+  char *text = malloc((size_t)d->text_len + 1);
+
+  d->key_first = malloc(((size_t)n + 1) * sizeof(uint32_t));
+  if (order == NULL || line_off == NULL || text == NULL || d->key_first == NULL
+      || !grow((void **)&d->key_off, &d->key_off_cap, (uint64_t)n + 1, sizeof(uint32_t))){
+    free(order);
+    free(line_off);
+    free(text);
+    return false;
+  }
+
+  d->key_off[n] = d->keys_len;
+  for (uint32_t i = 0; i < n; i++)
+    order[i] = i;
+  d->key_first[0] = 0;
+
+  bool ok = sort_lines(d, order, n, key_compar) && build(d, order);
+
+  // The lines are stored in the order of their keys, so the lines of a range of ranks are together.
+  uint32_t len = 0;
+  for (uint32_t i = 0; i < n; i++){
+    const char *line = d->text + d->line_off[order[i]];
+    size_t line_len = strlen(line) + 1;
+    memcpy(text + len, line, line_len);
+    line_off[i] = len;
+    len += line_len;
+  }
+
+  free(d->text);
+  free(d->line_off);
+  free(d->keys);
+  free(d->key_off);
+  d->text = text;
+  d->line_off = line_off;
+  d->line_id = order;
+  d->keys = NULL;
+  d->key_off = NULL;
+  return ok;
+}
+
+// Function which returns the number of bytes of the automaton and the lines (the size of its index file).
+size_t dawg_bytes(const dawg *d)
+{
+  return sizeof(dawg_header) + (size_t)d->state_count * sizeof(dawg_state)
+         + (size_t)d->trans_count * sizeof(dawg_trans)
+         + ((size_t)d->word_count + 1 + 2 * (size_t)d->line_count) * sizeof(uint32_t) + d->text_len;
+}
+
+// Function which writes an automaton into an index file.
+bool dawg_save(const dawg *d, const char *path)
+{
+  dawg_header h = {DAWG_MAGIC, DAWG_VERSION, d->state_count, d->trans_count, d->root,
+                   d->word_count, d->line_count, d->text_len};
+  FILE *f = fopen(path, "wb");
+  if (f == NULL)
+    return false;
+
+  bool ok = fwrite(&h, sizeof(h), 1, f) == 1
+            && fwrite(d->states, sizeof(dawg_state), d->state_count, f) == d->state_count
+            && fwrite(d->trans, sizeof(dawg_trans), d->trans_count, f) == d->trans_count
+            && fwrite(d->key_first, sizeof(uint32_t), d->word_count + 1, f) == d->word_count + 1
+            && fwrite(d->line_off, sizeof(uint32_t), d->line_count, f) == d->line_count
+            && fwrite(d->line_id, sizeof(uint32_t), d->line_count, f) == d->line_count
+            && fwrite(d->text, 1, d->text_len, f) == d->text_len;
+  return (fclose(f) == 0) && ok;
+}
+
+// Function which maps an index file into memory as a read-only automaton.
+bool dawg_map(dawg *d, const char *path)
+{
+  struct stat st;
+  dawg_init(d);
+
+  int fd = open(path, O_RDONLY);
+  if (fd == -1)
+    return false;
+  if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(dawg_header)){
+    close(fd);
+    return false;
+  }
+
+  void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+    return false;
+
+  const dawg_header *h = map;
+  d->state_count = h->state_count;
+  d->trans_count = h->trans_count;
+  d->word_count = h->word_count;
+  d->line_count = h->line_count;
+  d->text_len = h->text_len;
+  // Only the header is checked here, the states and lines are checked by dawg_query() when it reaches them.
+  const char *text = (const char *)map + st.st_size - d->text_len;
+  if (h->magic != DAWG_MAGIC || h->version != DAWG_VERSION || h->root >= h->state_count
+      || dawg_bytes(d) != (size_t)st.st_size || (d->line_count > 0 && d->text_len == 0)
+      || (d->text_len > 0 && text[d->text_len - 1] != '\0')){
+    munmap(map, st.st_size);
+    dawg_init(d);
+    return false;
+  }
+
+  char *p = (char *)map + sizeof(dawg_header);
+  d->states = (dawg_state *)p;
+  p += (size_t)d->state_count * sizeof(dawg_state);
+  d->trans = (dawg_trans *)p;
+  p += (size_t)d->trans_count * sizeof(dawg_trans);
+  d->key_first = (uint32_t *)p;
+  p += ((size_t)d->word_count + 1) * sizeof(uint32_t);
+  d->line_off = (uint32_t *)p;
+  p += (size_t)d->line_count * sizeof(uint32_t);
+  d->line_id = (uint32_t *)p;
+  p += (size_t)d->line_count * sizeof(uint32_t);
+  d->text = p;
+  d->root = h->root;
+  d->map = map;
+  d->map_len = st.st_size;
+  return true;
+}
+
+// Function which checks that the transitions of a state lie in the mapped index.
+static bool state_valid(const dawg *d, uint32_t state)
+{
+  const dawg_state *s = &d->states[state];
+  return (uint64_t)s->first + (s->count & ~DAWG_FINAL) <= d->trans_count && s->words <= d->word_count;
+}
+
+// Function which frees a failed answer, returns false.
+static bool query_failed(dawg_answer *a, uint32_t *set, uint32_t *next, bool damaged)
+{
+  free(set);
+  free(next);
+  free(a->term);
+  a->term = NULL;
+  a->damaged = damaged;
+  return false;
+}
+
+/* Function which computes the answer for a prefix of length len (in bytes), a->term has to be freed.
+   The typed characters are folded, so a prefix can lead to more states (e.g. "C" to both "C" and "Č"),
+   each of them is kept with the rank of its first key. The paths to them end in different keys, so there are
+   never more of them than keys. Every state, rank and line is checked against the mapped index before it is used. */
+bool dawg_query(const dawg *d, const char *prefix, size_t len, dawg_answer *a)
+{
+  uint32_t *set = malloc(2 * sizeof(uint32_t)), *next = NULL; // pairs of a state and a rank
+  uint32_t size = 1, set_cap = 1, next_cap = 0, term_cap = 0;
+
+  memset(a, 0, sizeof(*a));
+  a->unique = UINT32_MAX;
+  if (set == NULL)
+    return false;
+  set[0] = d->root;
+  set[1] = 0;
+
+  for (size_t i = 0; i < len && size > 0; ){
+    uint32_t c = utf8_fold(utf8_next(prefix, len, &i)), next_size = 0;
+
+    for (uint32_t k = 0; k < size; k++){
+      const dawg_state *s = &d->states[set[2*k]];
+      uint32_t rank = set[2*k+1] + ((s->count & DAWG_FINAL) ? 1 : 0);
+
+      if (!state_valid(d, set[2*k]))
+        return query_failed(a, set, next, true);
+      for (uint32_t t = s->first; t < s->first + (s->count & ~DAWG_FINAL); t++){
+        if (d->trans[t].target >= d->state_count)
+          return query_failed(a, set, next, true);
+        if (utf8_fold(d->trans[t].label) == c){
+          if (next_size >= d->word_count)
+            return query_failed(a, set, next, true);
+          if (!grow((void **)&next, &next_cap, (uint64_t)next_size + 1, 2 * sizeof(uint32_t)))
+            return query_failed(a, set, next, false);
+          next[2*next_size] = d->trans[t].target;
+          next[2*next_size+1] = rank;
+          next_size++;
+        }
+        rank += d->states[d->trans[t].target].words;
+      }
+    }
+
+    uint32_t *swap = set, swap_cap = set_cap;
+    set = next;
+    set_cap = next_cap;
+    next = swap;
+    next_cap = swap_cap;
+    size = next_size;
+  }
+
+  // The ranks of the keys of a state are [rank, rank + words), the first one is the prefix if the state is final.
+  for (uint32_t k = 0; k < size; k++){
+    const dawg_state *s = &d->states[set[2*k]];
+    uint32_t rank = set[2*k+1], final = (s->count & DAWG_FINAL) ? 1 : 0;
+
+    if (!state_valid(d, set[2*k]) || (uint64_t)rank + s->words > d->word_count || final > s->words)
+      return query_failed(a, set, next, true);
+    const uint32_t *first = d->key_first + rank;
+    if (first[0] > first[final] || first[final] > first[s->words] || first[s->words] > d->line_count)
+      return query_failed(a, set, next, true);
+
+    a->found = true;
+    for (uint32_t line = first[0]; line < first[final]; line++){
+      if (d->line_off[line] >= d->text_len)
+        return query_failed(a, set, next, true);
+      if (!grow((void **)&a->term, &term_cap, (uint64_t)a->term_count + 1, sizeof(uint32_t)))
+        return query_failed(a, set, next, false);
+      a->term[a->term_count++] = line;
+    }
+
+    uint32_t longer = first[s->words] - first[final];
+    if (longer > 0 && a->count == 0){
+      if (d->line_off[first[final]] >= d->text_len)
+        return query_failed(a, set, next, true);
+      a->unique = first[final];
+    }
+    a->count += longer;
+
+    for (uint32_t t = s->first; t < s->first + (s->count & ~DAWG_FINAL); t++){
+      int slot = enable_slot(d->trans[t].label);
+      if (slot >= 0)
+        a->enable |= (uint64_t)1 << slot;
+    }
+  }
+  if (!sort_lines(d, a->term, a->term_count, line_id_compar))
+    return query_failed(a, set, next, false);
+  free(set);
+  free(next);
+  return true;
+}
+
+// Function which returns the original text of a line.
+const char *dawg_line(const dawg *d, uint32_t line)
+{
+  return d->text + d->line_off[line];
+}
@@ -0,0 +1,116 @@
+/*
+ * File:          dawg.h
+ * Date:          05. 11. 2017
+ * Author:        Dominik Vecera, xvecer23@stud.fit.vutbr.cz
+ * Project:       Working with text
+ * Description:   Minimal acyclic automaton (DAWG) of the city database. Unlike the trie (index.h), states
+ *                with the same continuations are shared, so the common endings of the names (" nad Labem",
+ *                "ice", "ov") are stored once. It is built incrementally from the sorted keys (the algorithm
+ *                of Daciuk et al.), every state knows the number of keys accepted from it, which gives the rank
+ *                of a key and so the range of the original lines (sorted by the keys) starting with a prefix.
+ *                The keys keep the diacritics of the capital letters of the Enable alphabet, so the Enable
+ *                output is read from the labels of the transitions, and a query follows every transition
+ *                whose label folds to the typed character.
+ */
+
+#ifndef DAWG_H
+#define DAWG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define DAWG_MAGIC 0x57443150u // "P1DW" at the start of a DAWG index file
+#define DAWG_VERSION 1
+#define DAWG_FINAL 0x80000000u // flag of a final state in dawg_state.count
+
+// State of the automaton, its transitions are trans[first..first+count), sorted by the label.
+typedef struct {
+  uint32_t first;
+  uint32_t count;  // number of transitions, DAWG_FINAL is set if a key ends here
+  uint32_t words;  // number of keys accepted from the state
+} dawg_state;
+
+// Transition of the automaton.
+typedef struct {
+  uint32_t label;  // character of the key
+  uint32_t target; // state
+} dawg_trans;
+
+// The automaton together with the original lines of the database, sorted by their keys.
+typedef struct {
+  dawg_state *states;
+  uint32_t state_count;
+  dawg_trans *trans;
+  uint32_t trans_count;
+  uint32_t root;
+  uint32_t *key_first; // key_first[rank] - first line with the key of the rank, key_first[word_count] = line_count
+  uint32_t word_count;
+  uint32_t *line_off;  // offset of every line in text
+  uint32_t *line_id;   // number of every line in the database
+  uint32_t line_count;
+  char *text;          // original lines without the weights, each terminated by '\0'
+  uint32_t text_len;
+  uint32_t *keys;      // keys of the lines while the automaton is built
+  uint32_t *key_off;   // key_off[line] - offset of the key of a line in keys
+  uint32_t keys_len;
+  uint32_t keys_cap;
+  uint32_t key_off_cap;
+  uint32_t line_cap;
+  uint32_t text_cap;
+  void *map;           // mapped index file the arrays point into, NULL if they are allocated
+  size_t map_len;
+} dawg;
+
+// Header of a DAWG index file, followed by the states, trans, key_first, line_off, line_id and text arrays.
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t state_count;
+  uint32_t trans_count;
+  uint32_t root;
+  uint32_t word_count;
+  uint32_t line_count;
+  uint32_t text_len;
+} dawg_header;
+
+// Answer for a prefix computed on the automaton.
+typedef struct {
+  bool found;          // some line starts with the prefix
+  uint64_t enable;     // set of the available following characters
+  uint32_t count;      // number of lines longer than the prefix
+  uint32_t unique;     // the line longer than the prefix if count == 1
+  uint32_t *term;      // lines equal to the prefix in the order of the database
+  uint32_t term_count;
+  bool damaged;        // the query failed because the index file is not valid
+} dawg_answer;
+
+// Function which initializes an empty automaton to which lines can be added.
+void dawg_init(dawg *d);
+
+// Function which frees all memory of an automaton.
+void dawg_free(dawg *d);
+
+// Function which adds a line of length len (without the newline) of the database.
+bool dawg_add(dawg *d, const char *line, size_t len);
+
+// Function which sorts the added lines by their keys and builds the minimal automaton of the keys.
+bool dawg_finish(dawg *d);
+
+// Function which returns the number of bytes of the automaton and the lines (the size of its index file).
+size_t dawg_bytes(const dawg *d);
+
+// Function which writes an automaton into an index file.
+bool dawg_save(const dawg *d, const char *path);
+
+// Function which maps an index file into memory as a read-only automaton.
+bool dawg_map(dawg *d, const char *path);
+
+/* Function which computes the answer for a prefix of length len (in bytes), a->term has to be freed.
+   Returns false if there is not enough memory or, with a->damaged set, if the mapped index is not valid. */
+bool dawg_query(const dawg *d, const char *prefix, size_t len, dawg_answer *a);
+
+// Function which returns the original text of a line.
+const char *dawg_line(const dawg *d, uint32_t line);
+
+#endif
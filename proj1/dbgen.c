@@ -0,0 +1,176 @@
+/*
+ * File:          dbgen.c
+ * Date:          05. 11. 2017
+ * Author:        Dominik Vecera, xvecer23@stud.fit.vutbr.cz
+ * Project:       Working with text
+ * Description:   Generator of large city databases for the benchmark (make bench, see qbench.c).
+ *                Usage: dbgen N [SEED] > database
+ *                The names are made of Czech syllables. Their roots are drawn from a Zipf distribution,
+ *                so a few prefixes are very common and most are rare, and they end with shared suffixes
+ *                and district names, as the names of real places do. Some lines are in small or capital
+ *                letters only and about one line in a thousand is several kilobytes long.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#define ROOTS 4096         // number of different roots of the names
+#define ZIPF_EXPONENT 1.0
+#define MAX_ENTRIES 100000000
+#define LONG_LINE_RATE 1000 // one line in LONG_LINE_RATE is long
+#define LONG_LINE_PARTS 200 // maximal number of districts in a long line
+
+static const char *initials[] = {
+  "Br", "Pra", "Ost", "Plz", "Li", "Olo", "Čes", "Bu", "Hra", "Krá", "Par", "Zlín", "Hav", "Kla",
+  "Most", "Opa", "Frý", "Ka", "Jih", "Tep", "Dě", "Cho", "Pře", "Jab", "Mla", "Bo", "Pro", "Tře",
+  "Zno", "Kro", "Vy", "Šum", "Tá", "Kut", "Hor", "Žď", "Sá", "Ús", "Ji", "Ry", "Ro", "Ře",
+};
+
+static const char *syllables[] = {
+  "no", "ha", "ra", "eň", "be", "rec", "mo", "uc", "ké", "dě", "jo", "vi", "ce", "dec", "lo", "vé",
+  "du", "ří", "dno", "va", "dek", "rvi", "ná", "la", "li", "čín", "mu", "tov", "rov", "nec", "dá",
+  "le", "slav", "stě", "jov", "bíč", "jmo", "měř", "íž", "šk", "ov", "perk", "bor", "ár", "za",
+  "vou", "tí", "chn", "hra", "kov", "ber", "ště",
+};
+
+static const char *suffixes[] = {
+  "", "", "", "ov", "ice", "any", "ín", "ec", "ovice", "ná", "ky", "nice", "ín", "ov", "í", "y",
+};
+
+static const char *districts[] = {
+  " nad Labem", " nad Vltavou", " nad Sázavou", " nad Orlicí", " pod Radhoštěm", " u Brna", " u Prahy",
+  "-Město", "-Staré Město", "-Nové Město", "-Předměstí", " I", " II", " III", " 1", " 2", " 5",
+};
+
+#define COUNT(a) (sizeof(a) / sizeof((a)[0]))
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+// Function which returns the next pseudorandom number (xorshift64*).
+uint64_t next_random(void)
+{
+  rng_state ^= rng_state >> 12;
+  rng_state ^= rng_state << 25;
+  rng_state ^= rng_state >> 27;
+  return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+// Function which returns a pseudorandom number from 0 to n-1.
+uint32_t random_below(uint32_t n)
+{
+  return (uint32_t)((next_random() >> 32) * n >> 32);
+}
+
+// Function which makes the roots of the names from two or three syllables, the root i is the i-th most common one.
+void make_roots(char roots[ROOTS][32])
+{
+  for (int i = 0; i < ROOTS; i++){
+    uint32_t parts = 2 + random_below(2);
+    strcpy(roots[i], initials[random_below(COUNT(initials))]);
+    for (uint32_t j = 1; j < parts; j++)
+      strcat(roots[i], syllables[random_below(COUNT(syllables))]);
+  }
+}
+
+// Function which computes the cumulative distribution of the ranks of the roots.
+void make_zipf(double cdf[ROOTS])
+{
+  double sum = 0.0;
+
+  for (int i = 0; i < ROOTS; i++){
+    sum += 1.0 / pow(i + 1, ZIPF_EXPONENT);
+    cdf[i] = sum;
+  }
+  for (int i = 0; i < ROOTS; i++)
+    cdf[i] /= sum;
+}
+
+// Function which draws the rank of a root from the Zipf distribution.
+int zipf_rank(const double cdf[ROOTS])
+{
+  double u = (next_random() >> 11) * (1.0 / 9007199254740992.0);
+  int low = 0, high = ROOTS - 1;
+
+  while (low < high){
+    int mid = (low + high) / 2;
+    if (cdf[mid] < u)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+  return low;
+}
+
+// Function which prints a name with its ASCII letters changed to small (case < 0) or capital (case > 0) ones.
+void print_case(const char *name, int letter_case)
+{
+  for (const char *c = name; *c != '\0'; c++){
+    char ch = *c;
+    if (letter_case < 0 && ch >= 'A' && ch <= 'Z')
+      ch += 'a' - 'A';
+    else if (letter_case > 0 && ch >= 'a' && ch <= 'z')
+      ch -= 'a' - 'A';
+    putchar(ch);
+  }
+}
+
+// Function which prints one city of the database.
+void print_city(char roots[ROOTS][32], const double cdf[ROOTS])
+{
+  uint32_t c = random_below(20);
+  int letter_case = (c == 0) ? -1 : (c == 1) ? 1 : 0;
+
+  print_case(roots[zipf_rank(cdf)], letter_case);
+  print_case(suffixes[random_below(COUNT(suffixes))], letter_case);
+  if (random_below(3) == 0)
+    print_case(districts[random_below(COUNT(districts))], letter_case);
+  if (random_below(4) == 0){ // a part of a town named after another place
+    putchar('-');
+    print_case(roots[zipf_rank(cdf)], letter_case);
+    print_case(suffixes[random_below(COUNT(suffixes))], letter_case);
+  }
+  if (random_below(LONG_LINE_RATE) == 0){
+    uint32_t parts = 1 + random_below(LONG_LINE_PARTS);
+    for (uint32_t i = 0; i < parts; i++){
+      print_case(districts[random_below(COUNT(districts))], letter_case);
+      print_case(roots[random_below(ROOTS)], letter_case);
+    }
+  }
+  putchar('\n');
+}
+
+int main(int argc, char* argv[])
+{
+  static char roots[ROOTS][32];
+  static double cdf[ROOTS];
+  char *end;
+
+  if (argc < 2 || argc > 3){
+    fprintf(stderr, "Usage: dbgen N [SEED] > database\n");
+    return 1;
+  }
+  long entries = strtol(argv[1], &end, 10);
+  if (*end != '\0' || entries < 1 || entries > MAX_ENTRIES){
+    fprintf(stderr, "The number of entries has to be from 1 to %d.\n", MAX_ENTRIES);
+    return 1;
+  }
+  if (argc == 3){
+    unsigned long long seed = strtoull(argv[2], &end, 10);
+    if (*end != '\0'){
+      fprintf(stderr, "The seed has to be a number.\n");
+      return 1;
+    }
+    rng_state ^= seed * 0xBF58476D1CE4E5B9ULL;
+    if (rng_state == 0)
+      rng_state = 1;
+  }
+
+  make_roots(roots);
+  make_zipf(cdf);
+  for (long i = 0; i < entries; i++)
+    print_city(roots, cdf);
+  return fflush(stdout) == 0 ? 0 : 1;
+}
@@ -0,0 +1,591 @@
+/*
+ * File:          index.c
+ * Date:          05. 11. 2017
+ * Author:        Dominik Vecera, xvecer23@stud.fit.vutbr.cz
+ * Project:       Working with text
+ * Description:   Case-folded trie of the city database, see index.h.
+ */
+
+#define _POSIX_C_SOURCE 200809L // open, fstat, mmap
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "index.h"
+
+#define INITIAL_CAPACITY 64
+
+// Function which makes sure that an array has space for at least one more item.
+static bool reserve(void **array, uint32_t *cap, uint32_t count, size_t item_size)
+{
+  if (count < *cap)
+    return true;
+
+  size_t new_cap = *cap ? (size_t)*cap * 2 : INITIAL_CAPACITY;
+  if (new_cap > UINT32_MAX)
+    new_cap = UINT32_MAX; // the counts are 32-bit
+  if (new_cap <= count || new_cap > SIZE_MAX / item_size)
+    return false;
+  void *new_array = realloc(*array, new_cap * item_size);
+  if (new_array == NULL)
+    return false;
+
+  *array = new_array;
+  *cap = new_cap;
+  return true;
+}
+
+// Function which appends a new empty node with the given label and returns its index.
+static uint32_t new_node(trie *t, uint32_t label)
+{
+  if (!reserve((void **)&t->nodes, &t->node_cap, t->node_count, sizeof(trie_node)))
+    return NO_NODE;
+
+  trie_node *n = &t->nodes[t->node_count];
+  n->first_child = NO_NODE;
+  n->next_sibling = NO_NODE;
+  n->enable = 0;
+  n->count = 0;
+  n->unique = NO_LINE;
+  n->term = NO_LINE;
+  n->label = label;
+  n->top = 0;
+  n->top_count = 0;
+  return t->node_count++;
+}
+
+// Function which initializes an empty trie containing only the root node.
+bool trie_init(trie *t)
+{
+  memset(t, 0, sizeof(*t));
+  return new_node(t, '\0') != NO_NODE;
+}
+
+// Function which frees all memory of a trie.
+void trie_free(trie *t)
+{
+  if (t->map != NULL)
+    munmap(t->map, t->map_len);
+  else {
+    free(t->nodes);
+    free(t->text);
+    free(t->line_off);
+    free(t->line_next);
+    free(t->line_weight);
+    free(t->top_lines);
+  }
+  memset(t, 0, sizeof(*t));
+}
+
+// Function which returns the number of bytes of a trie (the size of its index file).
+size_t trie_bytes(const trie *t)
+{
+  return sizeof(index_header) + (size_t)t->node_count * sizeof(trie_node)
+         + ((size_t)t->line_count * 3 + t->top_len) * sizeof(uint32_t) + t->text_len;
+}
+
+// Function which writes a trie into an index file.
+bool trie_save(const trie *t, const char *path)
+{
+  index_header h = {INDEX_MAGIC, INDEX_VERSION, sizeof(trie_node), t->node_count,
+                    t->line_count, t->text_len, t->top_len, 0};
+  FILE *f = fopen(path, "wb");
+  if (f == NULL)
+    return false;
+
+  bool ok = fwrite(&h, sizeof(h), 1, f) == 1
+            && fwrite(t->nodes, sizeof(trie_node), t->node_count, f) == t->node_count
+            && fwrite(t->line_off, sizeof(uint32_t), t->line_count, f) == t->line_count
+            && fwrite(t->line_next, sizeof(uint32_t), t->line_count, f) == t->line_count
+            && fwrite(t->line_weight, sizeof(uint32_t), t->line_count, f) == t->line_count
+            && fwrite(t->top_lines, sizeof(uint32_t), t->top_len, f) == t->top_len
+            && fwrite(t->text, 1, t->text_len, f) == t->text_len;
+  return (fclose(f) == 0) && ok;
+}
+
+// Function which marks the target of a link, returns false if it is out of range or it already has a link.
+static bool link_once(uint8_t *linked, uint32_t target, uint32_t count)
+{
+  if (target >= count || linked[target])
+    return false;
+  linked[target] = 1;
+  return true;
+}
+
+/* Function which checks all links of a trie (of a mapped index file with --check), it reads the whole file.
+   Besides the orders checked when the links are followed, every node but the root and every line can be linked
+   only once (as a child or a sibling, as the first or the next equal line). */
+bool trie_check(const trie *t)
+{
+  uint32_t count = (t->node_count > t->line_count) ? t->node_count : t->line_count;
+  uint8_t *linked = calloc(count, 1);
+  if (linked == NULL)
+    return false;
+
+  // Every line has to end inside the text.
+  bool ok = (t->text_len == 0) ? t->line_count == 0 : t->text[t->text_len - 1] == '\0';
+  linked[0] = 1; // the root
+  for (uint32_t i = 0; ok && i < t->node_count; i++){
+    const trie_node *n = &t->nodes[i];
+    ok = (n->first_child == NO_NODE || (n->first_child > i && link_once(linked, n->first_child, t->node_count)))
+         && (n->next_sibling == NO_NODE || (n->next_sibling < i && link_once(linked, n->next_sibling, t->node_count)))
+         && (n->unique == NO_LINE || n->unique < t->line_count)
+         && n->top_count <= TOP_K_MAX && n->top <= t->top_len && n->top_count <= t->top_len - n->top;
+  }
+
+  if (ok)
+    memset(linked, 0, count);
+  for (uint32_t i = 0; ok && i < t->node_count; i++)
+    ok = t->nodes[i].term == NO_LINE || link_once(linked, t->nodes[i].term, t->line_count);
+  for (uint32_t i = 0; ok && i < t->line_count; i++)
+    ok = t->line_off[i] < t->text_len
+         && (t->line_next[i] == NO_LINE || (t->line_next[i] > i && link_once(linked, t->line_next[i], t->line_count)));
+  for (uint32_t i = 0; ok && i < t->top_len; i++)
+    ok = t->top_lines[i] < t->line_count;
+
+  free(linked);
+  return ok;
+}
+
+/* Function which maps an index file into memory as a read-only trie, returns false if its header or size is wrong.
+   Only what takes constant time is checked here, the links are checked when the queries follow them. */
+bool trie_map(trie *t, const char *path)
+{
+  struct stat st;
+  memset(t, 0, sizeof(*t));
+
+  int fd = open(path, O_RDONLY);
+  if (fd == -1)
+    return false;
+  if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(index_header)){
+    close(fd);
+    return false;
+  }
+
+  void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+    return false;
+
+  /* The file must have been written by a compatible program and have exactly the announced size,
+     and every line has to end inside the text. */
+  const index_header *h = map;
+  const char *text = (const char *)map + st.st_size - h->text_len;
+  size_t expected = sizeof(index_header) + (size_t)h->node_count * sizeof(trie_node)
+                    + ((size_t)h->line_count * 3 + h->top_len) * sizeof(uint32_t) + h->text_len;
+  if (h->magic != INDEX_MAGIC || h->version != INDEX_VERSION || h->node_size != sizeof(trie_node)
+      || h->node_count == 0 || expected != (size_t)st.st_size
+      || (h->text_len == 0 ? h->line_count != 0 : text[h->text_len - 1] != '\0')){
+    munmap(map, st.st_size);
+    return false;
+  }
+
+  char *p = (char *)map + sizeof(index_header);
+  t->nodes = (trie_node *)p;
+  p += (size_t)h->node_count * sizeof(trie_node);
+  t->line_off = (uint32_t *)p;
+  p += (size_t)h->line_count * sizeof(uint32_t);
+  t->line_next = (uint32_t *)p;
+  p += (size_t)h->line_count * sizeof(uint32_t);
+  t->line_weight = (uint32_t *)p;
+  p += (size_t)h->line_count * sizeof(uint32_t);
+  t->top_lines = (uint32_t *)p;
+  p += (size_t)h->top_len * sizeof(uint32_t);
+  t->text = p;
+  t->node_count = h->node_count;
+  t->line_count = h->line_count;
+  t->text_len = h->text_len;
+  t->top_len = h->top_len;
+  t->map = map;
+  t->map_len = st.st_size;
+  return true;
+}
+
+/* The links of a mapped trie are checked when they are followed. Children are created after their parent and
+   put before its older children, and equal lines are linked in the order of the database, so in a valid trie
+   each link points one way: a first child to a larger node, a sibling and the next equal line to a smaller and
+   a larger one. A link out of range or against its order ends the list, a damaged file can then give wrong
+   answers, but the queries never read outside of it or loop. */
+
+// Function which returns the first child of a node or NO_NODE.
+static uint32_t first_child(const trie *t, uint32_t node)
+{
+  uint32_t child = t->nodes[node].first_child;
+  return (child > node && child < t->node_count) ? child : NO_NODE;
+}
+
+// Function which returns the next sibling of a node or NO_NODE.
+static uint32_t next_sibling(const trie *t, uint32_t node)
+{
+  uint32_t sibling = t->nodes[node].next_sibling;
+  return (sibling < node) ? sibling : NO_NODE;
+}
+
+// Function which returns the first line equal to the prefix of a node or NO_LINE.
+uint32_t trie_term(const trie *t, uint32_t node)
+{
+  uint32_t line = t->nodes[node].term;
+  return (line < t->line_count) ? line : NO_LINE;
+}
+
+// Function which returns the next line equal to the same prefix as a line or NO_LINE.
+uint32_t trie_next_line(const trie *t, uint32_t line)
+{
+  uint32_t next = t->line_next[line];
+  return (next > line && next < t->line_count) ? next : NO_LINE;
+}
+
+// Function which returns the ranked lines of a node and stores their number into count (0 if they are damaged).
+const uint32_t *trie_top(const trie *t, uint32_t node, uint32_t *count)
+{
+  const trie_node *n = &t->nodes[node];
+
+  *count = 0;
+  if (n->top_count > TOP_K_MAX || n->top > t->top_len || n->top_count > t->top_len - n->top)
+    return t->top_lines;
+  for (uint32_t i = 0; i < n->top_count; i++)
+    if (t->top_lines[n->top + i] >= t->line_count)
+      return t->top_lines;
+  *count = n->top_count;
+  return t->top_lines + n->top;
+}
+
+// Function which returns the child of a node for the folded character c or NO_NODE.
+uint32_t trie_child(const trie *t, uint32_t node, uint32_t c)
+{
+  uint32_t child = first_child(t, node);
+
+  while (child != NO_NODE && t->nodes[child].label != c)
+    child = next_sibling(t, child);
+  return child;
+}
+
+// Function which stores the original text of a line and its weight and returns its number.
+static uint32_t store_line(trie *t, const char *line, size_t len, uint32_t weight)
+{
+  uint32_t old_cap = t->line_cap;
+  if (!reserve((void **)&t->line_off, &t->line_cap, t->line_count, sizeof(uint32_t)))
+    return NO_LINE;
+  if (t->line_cap != old_cap){ // line_next and line_weight always have the same capacity as line_off
+    uint32_t *next = realloc(t->line_next, t->line_cap * sizeof(uint32_t));
+    if (next != NULL)
+      t->line_next = next;
+    uint32_t *weights = realloc(t->line_weight, t->line_cap * sizeof(uint32_t));
+    if (weights != NULL)
+      t->line_weight = weights;
+    if (next == NULL || weights == NULL){
+      t->line_cap = old_cap;
+      return NO_LINE;
+    }
+  }
+
+  // The offsets of the lines are 32-bit, so the text cannot grow past UINT32_MAX bytes.
+  if ((size_t)t->text_len + len + 1 > UINT32_MAX)
+    return NO_LINE;
+  while (t->text_len + len + 1 > t->text_cap){
+    size_t new_cap = t->text_cap ? (size_t)t->text_cap * 2 : INITIAL_CAPACITY;
+    if (new_cap > UINT32_MAX)
+      new_cap = UINT32_MAX;
+    char *text = realloc(t->text, new_cap);
+    if (text == NULL)
+      return NO_LINE;
+    t->text = text;
+    t->text_cap = new_cap;
+  }
+
+  memcpy(t->text + t->text_len, line, len);
+  t->text[t->text_len + len] = '\0';
+  t->line_off[t->line_count] = t->text_len;
+  t->line_next[t->line_count] = NO_LINE;
+  t->line_weight[t->line_count] = weight;
+  t->text_len += len + 1;
+  return t->line_count++;
+}
+
+// Function which returns the length of the name in a line of the database and reads its weight (0 if it has none).
+size_t split_weight(const char *line, size_t len, uint32_t *weight)
+{
+  size_t tab = len;
+  uint32_t value = 0;
+
+  *weight = 0;
+  while (tab > 0 && line[tab-1] >= '0' && line[tab-1] <= '9')
+    tab--;
+  if (tab == 0 || tab == len || line[tab-1] != '\t')
+    return len; // no weight, the whole line is the name
+
+  for (size_t i = tab; i < len; i++){ // too large weights are cut to UINT32_MAX
+    uint32_t digit = line[i] - '0';
+    value = (value > (UINT32_MAX - digit) / 10) ? UINT32_MAX : value * 10 + digit;
+  }
+  *weight = value;
+  return tab - 1;
+}
+
+// Function which adds a line of length len (without the newline) to a trie.
+bool trie_add(trie *t, const char *line, size_t len)
+{
+  uint32_t weight;
+  len = split_weight(line, len, &weight);
+  uint32_t id = store_line(t, line, len, weight);
+  if (id == NO_LINE)
+    return false;
+
+  uint32_t node = 0;
+  for (size_t i = 0; i < len; ){
+    // The line continues past the prefix of this node with the character c.
+    uint32_t c = utf8_next(line, len, &i);
+    trie_node *n = &t->nodes[node];
+    int slot = enable_slot(c);
+    if (slot >= 0)
+      n->enable |= (uint64_t)1 << slot;
+    if (n->count++ == 0)
+      n->unique = id;
+
+    c = utf8_fold(c);
+    uint32_t child = trie_child(t, node, c);
+    if (child == NO_NODE){
+      if ((child = new_node(t, c)) == NO_NODE)
+        return false;
+      // new_node() may have moved the nodes
+      t->nodes[child].next_sibling = t->nodes[node].first_child;
+      t->nodes[node].first_child = child;
+    }
+    node = child;
+  }
+
+  // Keep the lines equal to the prefix in the order of the database.
+  uint32_t *last = &t->nodes[node].term;
+  while (*last != NO_LINE)
+    last = &t->line_next[*last];
+  *last = id;
+  return true;
+}
+
+// Function which finds the node of a prefix of length len (in bytes), returns NO_NODE if no line starts with it.
+uint32_t trie_find(const trie *t, const char *prefix, size_t len)
+{
+  uint32_t node = 0;
+  for (size_t i = 0; i < len && node != NO_NODE; )
+    node = trie_child(t, node, utf8_fold(utf8_next(prefix, len, &i)));
+  return node;
+}
+
+// Function which finds out if the line a ranks before the line b - heavier first, then in the order of the database.
+static bool ranks_before(const trie *t, uint32_t a, uint32_t b)
+{
+  if (t->line_weight[a] != t->line_weight[b])
+    return t->line_weight[a] > t->line_weight[b];
+  return a < b;
+}
+
+// Function which inserts a line into a ranked list of at most TOP_K_MAX lines, if it is heavy enough.
+static void rank_insert(const trie *t, uint32_t *list, uint32_t *count, uint32_t line)
+{
+  uint32_t i = *count;
+  if (i == TOP_K_MAX){
+    if (!ranks_before(t, line, list[i-1]))
+      return;
+    i--;
+  }
+  else
+    (*count)++;
+
+  while (i > 0 && ranks_before(t, line, list[i-1])){
+    list[i] = list[i-1];
+    i--;
+  }
+  list[i] = line;
+}
+
+/* Function which computes the ranked lines of all nodes, it has to be called after the last trie_add().
+   Children are always created after their parent, so going from the last node to the root visits every
+   node after all its descendants and its list is merged from the lists of its children. */
+bool trie_rank(trie *t)
+{
+  uint32_t list[TOP_K_MAX], count, cap = 0;
+
+  free(t->top_lines);
+  t->top_lines = NULL;
+  t->top_len = 0;
+  for (uint32_t node = t->node_count; node-- > 0; ){
+    trie_node *n = &t->nodes[node];
+
+    count = 0;
+    for (uint32_t line = n->term; line != NO_LINE; line = t->line_next[line])
+      rank_insert(t, list, &count, line);
+    for (uint32_t child = n->first_child; child != NO_NODE; child = t->nodes[child].next_sibling){
+      const trie_node *c = &t->nodes[child];
+      for (uint32_t i = 0; i < c->top_count; i++)
+        rank_insert(t, list, &count, t->top_lines[c->top + i]);
+    }
+
+    if ((size_t)t->top_len + count > UINT32_MAX)
+      return false;
+    while (t->top_len + count > cap){
+      size_t new_cap = cap ? (size_t)cap * 2 : INITIAL_CAPACITY;
+      if (new_cap > UINT32_MAX)
+        new_cap = UINT32_MAX;
+      uint32_t *top = realloc(t->top_lines, new_cap * sizeof(uint32_t));
+      if (top == NULL)
+        return false;
+      t->top_lines = top;
+      cap = new_cap;
+    }
+    memcpy(t->top_lines + t->top_len, list, count * sizeof(uint32_t));
+    n->top = t->top_len;
+    n->top_count = count;
+    t->top_len += count;
+  }
+  return true;
+}
+
+// State of the search for the nodes within an edit distance of a prefix.
+typedef struct {
+  const trie *t;
+  const uint32_t *chars; // the searched prefix
+  size_t count;
+  uint32_t k;
+  uint32_t *rows;        // rows + d * (count + 1) - row of the node in the depth d
+  fuzzy_match *matches;
+  uint32_t match_count;
+  uint32_t match_cap;
+  uint32_t visited;      // number of the visited nodes, a valid trie has no more of them than node_count
+  bool error;
+} fuzzy_search;
+
+// Function which appends a matched node to the result of a fuzzy search.
+static bool add_match(fuzzy_search *f, uint32_t node, uint32_t distance)
+{
+  if (!reserve((void **)&f->matches, &f->match_cap, f->match_count, sizeof(fuzzy_match))){
+    f->error = true;
+    return false;
+  }
+  f->matches[f->match_count].node = node;
+  f->matches[f->match_count++].distance = distance;
+  return true;
+}
+
+/* Function which continues the search in the children of a node in the given depth. The row of a node holds
+   the edit distances between its prefix and the first j characters of the searched prefix for all j. It is the
+   state of the Levenshtein automaton after reading the prefix of the node, so the rows of the children are
+   computed from it without looking at the lines. best is the distance of the closest matched ancestor. */
+static void fuzzy_walk(fuzzy_search *f, uint32_t node, size_t depth, uint32_t best)
+{
+  const uint32_t *row = f->rows + depth * (f->count + 1);
+  uint32_t *next = f->rows + (depth + 1) * (f->count + 1);
+
+  for (uint32_t child = first_child(f->t, node); child != NO_NODE && !f->error;
+       child = next_sibling(f->t, child)){
+    if (++f->visited > f->t->node_count) // a damaged file links some node more times
+      return;
+    uint32_t label = f->t->nodes[child].label, min;
+
+    next[0] = min = row[0] + 1;
+    for (size_t j = 1; j <= f->count; j++){
+      uint32_t d = row[j-1] + (f->chars[j-1] != label); // a substitution (or equal characters)
+      if (row[j] + 1 < d)
+        d = row[j] + 1; // an extra character in the node
+      if (next[j-1] + 1 < d)
+        d = next[j-1] + 1; // a missing character in the node
+      next[j] = d;
+      if (d < min)
+        min = d;
+    }
+
+    uint32_t distance = next[f->count], child_best = best;
+    if (distance <= f->k && distance < best){
+      if (!add_match(f, child, distance))
+        return;
+      child_best = distance;
+    }
+
+    // The distances of the descendants never drop below the minimum of the row.
+    if (min <= f->k && min < child_best)
+      fuzzy_walk(f, child, depth + 1, child_best);
+  }
+}
+
+// Function which compares fuzzy matches by the distance, then by the order of the nodes (for qsort()).
+static int fuzzy_compar(const void *a, const void *b)
+{
+  const fuzzy_match *x = a, *y = b;
+  if (x->distance != y->distance)
+    return x->distance < y->distance ? -1 : 1;
+  return (x->node > y->node) - (x->node < y->node);
+}
+
+/* Function which finds the nodes whose prefixes are within the edit distance k of the folded characters
+   chars[0..count), sorted by the distance. A node is left out if an ancestor is at least as close, as all its
+   lines are completions of the ancestor. Returns false if there is not enough memory, *matches has to be freed. */
+bool trie_fuzzy(const trie *t, const uint32_t *chars, size_t count, uint32_t k,
+                fuzzy_match **matches, size_t *match_count)
+{
+  // A node deeper than count + k is further than k from the prefix, so this many rows are enough.
+  fuzzy_search f = {t, chars, count, k, malloc((count + k + 2) * (count + 1) * sizeof(uint32_t)),
+                    NULL, 0, 0, 0, false};
+  uint32_t best = UINT32_MAX;
+
+  *matches = NULL;
+  *match_count = 0;
+  if (f.rows == NULL)
+    return false;
+
+  // The row of the root - every character of the prefix is missing.
+  for (size_t j = 0; j <= count; j++)
+    f.rows[j] = j;
+  if (count <= k && add_match(&f, 0, count))
+    best = count;
+  if (!f.error)
+    fuzzy_walk(&f, 0, 0, best);
+  free(f.rows);
+
+  if (f.error){
+    free(f.matches);
+    return false;
+  }
+  qsort(f.matches, f.match_count, sizeof(fuzzy_match), fuzzy_compar);
+  *matches = f.matches;
+  *match_count = f.match_count;
+  return true;
+}
+
+// Function which stores up to max lines of the subtree of a node into lines, returns false if there is not enough memory.
+bool trie_lines(const trie *t, uint32_t node, uint32_t *lines, size_t max, size_t *line_count)
+{
+  uint32_t *stack = NULL, depth = 0, cap = 0, visited = 0;
+  size_t n = 0;
+
+  // Depth-first walk with its own stack, the lines can be longer than the recursion could go.
+  if (!reserve((void **)&stack, &cap, depth, sizeof(uint32_t)))
+    return false;
+  stack[depth++] = node;
+  while (depth > 0 && n < max && visited++ < t->node_count){ // a damaged file can link some node more times
+    uint32_t cur = stack[--depth];
+    for (uint32_t line = trie_term(t, cur); line != NO_LINE && n < max; line = trie_next_line(t, line))
+      lines[n++] = line;
+    for (uint32_t child = first_child(t, cur); child != NO_NODE; child = next_sibling(t, child)){
+      if (!reserve((void **)&stack, &cap, depth, sizeof(uint32_t))){
+        free(stack);
+        return false;
+      }
+      stack[depth++] = child;
+    }
+  }
+
+  free(stack);
+  *line_count = n;
+  return true;
+}
+
+// Function which returns the original text of a line, an empty one if the line is not in the index.
+const char *trie_line(const trie *t, uint32_t line)
+{
+  if (line >= t->line_count || t->line_off[line] >= t->text_len)
+    return "";
+  return t->text + t->line_off[line];
+}
@@ -0,0 +1,140 @@
+/*
+ * File:          index.h
+ * Date:          05. 11. 2017
+ * Author:        Dominik Vecera, xvecer23@stud.fit.vutbr.cz
+ * Project:       Working with text
+ * Description:   Folded trie of the city database (without case and diacritics, see utf8.h). Every node keeps the answer for the prefix
+ *                it represents (enabled following characters, number of continuing cities and the
+ *                unique completion), so a query only walks the prefix.
+ *                A line of the database may end with a tab and a weight (popularity) of the city, every node
+ *                also keeps the TOP_K_MAX heaviest lines of its subtree, so the ranked completions of a prefix
+ *                are read without walking the subtree.
+ *                The trie can be saved to an index file and mapped back into memory without parsing,
+ *                all links are indexes, so the file does not depend on the address it is mapped at.
+ */
+
+#ifndef INDEX_H
+#define INDEX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "utf8.h"
+
+#define NO_NODE UINT32_MAX // missing node (child, sibling or the result of a lookup)
+#define NO_LINE UINT32_MAX // missing line (unique completion or exact match)
+
+#define FUZZY_MAX_K 2 // the largest edit distance of a fuzzy search
+
+#define INDEX_MAGIC 0x58493150u // "P1IX" at the start of an index file
+#define INDEX_VERSION 3
+
+#define TOP_K_MAX 8 // the most ranked completions kept in a node
+
+// Node of the trie, representing one folded prefix.
+typedef struct {
+  uint64_t enable;       // bit i set = character enable_chars[i] of the Enable output can follow
+  uint32_t first_child;  // first node with a one character longer prefix
+  uint32_t next_sibling; // next node with the same parent
+  uint32_t count;        // number of lines which are longer than the prefix
+  uint32_t unique;       // first line longer than the prefix (the completion if count == 1)
+  uint32_t term;         // first line equal to the prefix, others are linked by line_next
+  uint32_t label;        // folded last character of the prefix
+  uint32_t top;          // first of the ranked lines of the subtree in top_lines
+  uint32_t top_count;    // number of the ranked lines, at most TOP_K_MAX
+} trie_node;
+
+// The trie together with the original lines of the database.
+typedef struct {
+  trie_node *nodes;    // nodes[0] is the root (empty prefix)
+  uint32_t node_count;
+  uint32_t node_cap;
+  char *text;          // original lines, each terminated by '\0'
+  uint32_t text_len;
+  uint32_t text_cap;
+  uint32_t *line_off;  // offset of every line in text
+  uint32_t *line_next; // next line equal to the same prefix or NO_LINE
+  uint32_t *line_weight; // weight of every line, 0 if the database does not give one
+  uint32_t line_count;
+  uint32_t line_cap;
+  uint32_t *top_lines; // ranked lines of all nodes, from the heaviest (see trie_rank())
+  uint32_t top_len;
+  void *map;           // mapped index file the arrays point into, NULL if they are allocated
+  size_t map_len;
+} trie;
+
+// Header of an index file, followed by the nodes, line_off, line_next, line_weight, top_lines and text arrays.
+// Its size is a multiple of 8, so the nodes are aligned in the mapped file.
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t node_size;  // sizeof(trie_node) of the program which wrote the file
+  uint32_t node_count;
+  uint32_t line_count;
+  uint32_t text_len;
+  uint32_t top_len;
+  uint32_t padding;    // keeps the size a multiple of 8
+} index_header;
+
+// Node of the trie whose prefix is within an edit distance of a searched prefix (see trie_fuzzy()).
+typedef struct {
+  uint32_t node;
+  uint32_t distance;
+} fuzzy_match;
+
+// Function which initializes an empty trie containing only the root node.
+bool trie_init(trie *t);
+
+// Function which frees all memory of a trie.
+void trie_free(trie *t);
+
+// Function which returns the number of bytes of a trie (the size of its index file).
+size_t trie_bytes(const trie *t);
+
+// Function which writes a trie into an index file.
+bool trie_save(const trie *t, const char *path);
+
+/* Function which maps an index file into memory as a read-only trie, returns false if its header or size is wrong.
+   The links are checked when they are followed, a damaged file can give wrong answers but never a crash. */
+bool trie_map(trie *t, const char *path);
+
+// Function which checks all links of a trie, it reads the whole index file.
+bool trie_check(const trie *t);
+
+// Function which returns the length of the name in a line of the database and reads its weight (0 if it has none).
+size_t split_weight(const char *line, size_t len, uint32_t *weight);
+
+// Function which adds a line of length len (without the newline) to a trie.
+bool trie_add(trie *t, const char *line, size_t len);
+
+// Function which computes the ranked lines of all nodes, it has to be called after the last trie_add().
+bool trie_rank(trie *t);
+
+// Function which returns the child of a node for the folded character c or NO_NODE.
+uint32_t trie_child(const trie *t, uint32_t node, uint32_t c);
+
+// Function which returns the first line equal to the prefix of a node or NO_LINE.
+uint32_t trie_term(const trie *t, uint32_t node);
+
+// Function which returns the next line equal to the same prefix as a line or NO_LINE.
+uint32_t trie_next_line(const trie *t, uint32_t line);
+
+// Function which returns the ranked lines of a node and stores their number into count (0 if they are damaged).
+const uint32_t *trie_top(const trie *t, uint32_t node, uint32_t *count);
+
+// Function which finds the node of a prefix of length len (in bytes), returns NO_NODE if no line starts with it.
+uint32_t trie_find(const trie *t, const char *prefix, size_t len);
+
+/* Function which finds the nodes whose prefixes are within the edit distance k of the folded characters
+   chars[0..count), sorted by the distance. A node is left out if an ancestor is at least as close, as all its
+   lines are completions of the ancestor. Returns false if there is not enough memory, *matches has to be freed. */
+bool trie_fuzzy(const trie *t, const uint32_t *chars, size_t count, uint32_t k,
+                fuzzy_match **matches, size_t *match_count);
+
+// Function which stores up to max lines of the subtree of a node into lines, returns false if there is not enough memory.
+bool trie_lines(const trie *t, uint32_t node, uint32_t *lines, size_t max, size_t *line_count);
+
+// Function which returns the original text of a line, an empty one if the line is not in the index.
+const char *trie_line(const trie *t, uint32_t line);
+
+#endif
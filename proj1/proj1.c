@@ -1,20 +1,50 @@
-/*
- * File:          proj1.c
- * Date:          05. 11. 2017
- * Author:        Dominik Vecera, xvecer23@stud.fit.vutbr.cz
- * Project:       Working with text
+/*
+ * File:          proj1.c
+ * Date:          05. 11. 2017
+ * Author:        Dominik Vecera, xvecer23@stud.fit.vutbr.cz
+ * Project:       Working with text
  * Description:   The program emulates the algorithm of simulating a navigation's virtual keyboard.
  *                The input argument is compared to a database of available cities and a matching city is displayed, if found,
- *                and enabled following characters which lead to a result are displayed, if there are any.
+ *                and enabled following characters which lead to a result are displayed, if there are any.
+ *                With the argument --trie, the database is first loaded into a case-folded trie (index.c)
+ *                and the answer is read from the node of the input prefix.
+ *                The trie can be saved with --build-index FILE and later queried with --index FILE [PREFIX],
+ *                which maps the file into memory instead of reading the database. With --build-index FILE --dawg,
+ *                a minimal automaton sharing the common endings of the names is saved instead (dawg.c).
+ *                Mapping an index checks only its header, --index FILE --check reads the whole file and checks all links.
+ *                In the batch mode (--batch, after --index FILE or with the database on stdin), every line
+ *                of a file is taken as one input argument and the answers are separated by empty lines.
+ *                The session mode (--session, after --index FILE or with a database file) emulates the keyboard
+ *                itself: it reads keystrokes from stdin and answers the prefix typed so far after each of them.
+ *                All input is read in large blocks by reader.c, so the cities and prefixes can be of any length.
+ *                Without an index, the cities are compared with the folded input argument by vector instructions (scan.c).
+ *                The database and the input are in UTF-8, characters are compared without their case and diacritics
+ *                and the Enable output includes the Czech letters with diacritics (utf8.c).
+ *                With --fuzzy K PREFIX (also after --index FILE), cities starting within the edit distance K
+ *                of the prefix are printed, so a mistyped letter still finds the city.
+ *                A city in the database may be followed by a tab and its weight (popularity), --top K PREFIX
+ *                (also after --index FILE) prints the K heaviest cities starting with the prefix.
+ *                With --threads N, a database file on stdin is mapped into memory and scanned by N threads (pscan.c).
+ *                --daemon SOCKET FILE keeps the trie of a database or index file in memory and answers prefixes
+ *                sent over a Unix domain socket, SIGHUP reloads the file (daemon.c). An index file has to be
+ *                replaced by a new file (rename), not rewritten in place, while the daemon has it mapped.
  */
 
-#define BUFSIZE 101
-
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
+#include "index.h"
+#include "reader.h"
+#include "scan.h"
+#include "pscan.h"
+#include "dawg.h"
+#include "daemon.h"
+
+#define FUZZY_LIMIT 10 // the most cities printed by a fuzzy search
 
 // Function which returns the length of a string.
-int string_length(char *str)
+int string_length(const char *str)
 {
   int i = 0;
   while (str[i] != '\0')
@@ -23,147 +53,908 @@ int string_length(char *str)
 }
 
 // Function which finds out if there is something wrong with the input and if yes, informs the user.
-void errors(int argc, char* argv[])
+void errors(int argc)
 {
   if (argc > 2)
     fprintf(stderr, "Multiple arguments were set. Only the first argument will be taken into consideration.\n");
-  else if (argc > 1){
-    if ((string_length(argv[1])) > BUFSIZE-1){ // If the input argument is longer than 100 characters, truncate the rest.
-      fprintf(stderr, "The input argument is too long, characters after the 100th character truncated.\n");
-      argv[1][BUFSIZE-1] = '\0';
-    }
-  }
 }
 
-// Function which compares two letters based on their ASCII values and returns boolean value of the result.
-bool letter_compare(char ltr_1, char ltr_2)
+/* Function which saves the character at the byte i of a city into the set of available following
+   characters (a bit of the Enable alphabet, see utf8.h). */
+void save_char(size_t i, uint64_t *chars, const char *city, size_t city_len)
+{
+  int slot = enable_slot(utf8_next(city, city_len, &i));
+
+  if (slot >= 0)
+    *chars |= (uint64_t)1 << slot;
+}
+
+// Function which finds out whether there are any available following characters or not.
+bool find_print_chars(FILE *out, uint64_t chars, int enabled_cities)
 {
-  if ((ltr_1 == ltr_2) || (ltr_1 == (ltr_2 - ' ')) || (ltr_1 == (ltr_2 + ' ')))
+  bool char_available = chars != 0;
+
+  /* If there are available characters and multiple options, print all available chars, and if there is
+     only one available option, return a positive value so that it can be printed later. */
+  if (char_available && (enabled_cities > 1)){
+    fprintf(out, "Enable: ");
+    for (int i = 0; i < ENABLE_SLOTS; i++){
+      if (chars & ((uint64_t)1 << i))
+        fputs(enable_chars[i], out);
+    }
+    fputc('\n', out);
     return 1;
+  }
+  else if (char_available && (enabled_cities == 1)){
+    return 1;
+  }
   else
     return 0;
 }
 
-// Function which saves a character into an array as an available following character (based on ASCII codes).
-void save_char(int i, char chars[], char city[])
+// Function which loads the city database from a file into a trie, prints an error message on failure.
+bool build_index(trie *t, FILE *db)
 {
-  char found_char;
+  line_reader r;
+  char *city;
+  size_t len;
+  bool ok = reader_init(&r, db);
 
-  if (city[i] >= 'a' && city[i] <= 'z'){ // if the character is a small letter a-z (ASCII 97-122)
-    found_char = city[i] - ' ';
-    chars[found_char - 'A'] = found_char;
+  while (ok && reader_next(&r, &city, &len))
+    ok = trie_add(t, city, len);
+  ok = ok && !r.error;
+  bool read = !reader_input_error(&r);
+  reader_free(&r);
+  if (read && !(ok && trie_rank(t))){
+    fprintf(stderr, "Not enough memory to build the index of the database.\n");
+    return false;
   }
-  else if (city[i] >= 'A' && city[i] <= 'Z'){ // if the character is a capital letter A-Z (ASCII 65-90)
-    found_char = city[i];
-    chars[found_char - 'A'] = found_char;
+  return read && ok;
+}
+
+// Function which prints the answer for the prefix represented by a trie node (NO_NODE if there is none).
+void print_index_answer(FILE *out, const trie *t, uint32_t node)
+{
+  bool found_city = false;
+
+  if (node == NO_NODE){
+    fprintf(out, "Not found\n");
+    return;
   }
-  else if (city[i] == ' '){ // if the character is a space (ASCII 32)
-    found_char = city[i];
-    chars[found_char - 6] = found_char;
+
+  // Cities equal to the prefix, then the only city longer than the prefix, if there is just one.
+  const trie_node *n = &t->nodes[node];
+  for (uint32_t line = trie_term(t, node); line != NO_LINE; line = trie_next_line(t, line)){
+    fprintf(out, "Found: %s\n", trie_line(t, line));
+    found_city = true;
   }
-  else if (city[i] == '-'){ // if the character is an en dash (ASCII 45)
-    found_char = city[i];
-    chars[found_char - 18] = found_char;
+  if (n->count == 1){
+    fprintf(out, "Found: %s\n", trie_line(t, n->unique));
+    found_city = true;
   }
+
+  if (!(find_print_chars(out, n->enable, n->count)) && !(found_city))
+    fprintf(out, "Not found\n");
 }
 
-// Function which finds out whether there are any available following characters or not.
-bool find_print_chars(char chars[], int enabled_cities)
+// Function which answers the input argument (argv[1], if set) using a loaded trie.
+void answer_index(const trie *t, int argc, char* argv[])
 {
-  bool char_available = false;
-  int i = 0;
+  if (argc > 1){
+    errors(argc);
+    print_index_answer(stdout, t, trie_find(t, argv[1], string_length(argv[1])));
+  }
+  else // Without an argument, only the characters available at the start are printed.
+    find_print_chars(stdout, t->nodes[0].enable, t->line_count);
+}
+
+/* Function which prints the cities starting within the edit distance k of the input argument, the closest
+   first and at most FUZZY_LIMIT of them. Returns false if there is not enough memory. */
+bool print_fuzzy_answer(const trie *t, const char *prefix, uint32_t k)
+{
+  size_t len = string_length(prefix), count = 0, match_count, printed = 0;
+  uint32_t *chars = malloc((len + 1) * sizeof(uint32_t));
+  uint32_t shown[FUZZY_LIMIT], lines[2 * FUZZY_LIMIT];
+  fuzzy_match *matches;
 
-  for (i = 0; i < 28; i++){
-    if (chars[i] != 0){
-      char_available = true;
-      break;
+  if (chars == NULL)
+    return false;
+  for (size_t i = 0; i < len; )
+    chars[count++] = utf8_fold(utf8_next(prefix, len, &i));
+  bool ok = trie_fuzzy(t, chars, count, k, &matches, &match_count);
+  free(chars);
+
+  // A city can be in the subtrees of more matched nodes, it is printed with the smallest distance only.
+  for (size_t m = 0; ok && m < match_count && printed < FUZZY_LIMIT; m++){
+    size_t n;
+    ok = trie_lines(t, matches[m].node, lines, FUZZY_LIMIT + printed, &n);
+    for (size_t i = 0; ok && i < n && printed < FUZZY_LIMIT; i++){
+      size_t j = 0;
+      while (j < printed && shown[j] != lines[i])
+        j++;
+      if (j < printed)
+        continue;
+      printf("Found: %s (distance %u)\n", trie_line(t, lines[i]), (unsigned)matches[m].distance);
+      shown[printed++] = lines[i];
     }
   }
 
-  /* If there are available characters and multiple options, print all available chars, and if there is
-     only one available option, return a positive value so that it can be printed later. */
-  if (char_available && (enabled_cities > 1)){
-    printf("Enable: ");
-    for (i = 0; i < 28; i++){
-      printf("%c", chars[i]);
+  if (ok && printed == 0)
+    printf("Not found\n");
+  free(matches);
+  return ok;
+}
+
+// Function which reads the number given to an option (1 to max), prints an error message if it is not valid.
+bool option_number(const char *option, const char *arg, long max, uint32_t *number)
+{
+  char *end;
+  long value = strtol(arg, &end, 10);
+
+  if (*arg == '\0' || *end != '\0' || value < 1 || value > max){
+    fprintf(stderr, "The number given to %s has to be from 1 to %ld.\n", option, max);
+    return false;
+  }
+  *number = value;
+  return true;
+}
+
+// Function which answers the input argument argv[2] with the edit distance argv[1] using a loaded trie.
+int fuzzy_answer(const trie *t, int argc, char* argv[])
+{
+  uint32_t k;
+
+  if (argc != 3){
+    fprintf(stderr, "Usage: --fuzzy K PREFIX\n");
+    return 1;
+  }
+  if (!option_number("--fuzzy", argv[1], FUZZY_MAX_K, &k))
+    return 1;
+  if (!print_fuzzy_answer(t, argv[2], k)){
+    fprintf(stderr, "Not enough memory for the fuzzy search.\n");
+    return 1;
+  }
+  return 0;
+}
+
+// Function which prints the k heaviest cities starting with the prefix represented by a trie node (NO_NODE if none).
+void print_top_answer(const trie *t, uint32_t node, uint32_t k)
+{
+  if (node == NO_NODE){
+    printf("Not found\n");
+    return;
+  }
+
+  uint32_t count;
+  const uint32_t *top = trie_top(t, node, &count);
+  for (uint32_t i = 0; i < k && i < count; i++){
+    uint32_t line = top[i];
+    printf("Top: %s (weight %u)\n", trie_line(t, line), (unsigned)t->line_weight[line]);
+  }
+}
+
+// Function which answers the input argument argv[2] with the argv[1] heaviest cities using a loaded trie.
+int top_answer(const trie *t, int argc, char* argv[])
+{
+  uint32_t k;
+
+  if (argc != 3){
+    fprintf(stderr, "Usage: --top K PREFIX\n");
+    return 1;
+  }
+  if (!option_number("--top", argv[1], TOP_K_MAX, &k))
+    return 1;
+  print_top_answer(t, trie_find(t, argv[2], string_length(argv[2])), k);
+  return 0;
+}
+
+/* Function which answers every prefix from a file (one per line), each answer is followed by an empty line.
+   Returns false if there is not enough memory. */
+bool batch_answer(const trie *t, FILE *prefixes)
+{
+  line_reader r;
+  char *prefix;
+  uint32_t *chars = malloc(sizeof(uint32_t)); // folded characters of the prefix
+  uint32_t *prev = malloc(sizeof(uint32_t));  // folded characters of the previous prefix
+  uint32_t *path = malloc(sizeof(uint32_t));  // path[i] - node of the first i characters of the previous prefix
+  size_t len, cap = 0; // cap - number of characters the arrays have room for
+  size_t walked = 0; // number of characters of the previous prefix which have a node in path
+  bool ok = reader_init(&r, prefixes) && chars != NULL && prev != NULL && path != NULL;
+
+  if (ok)
+    path[0] = 0;
+  while (ok && reader_next(&r, &prefix, &len)){
+    if (len > cap){ // a prefix never has more characters than bytes
+      uint32_t *arrays[3] = {chars, prev, path};
+      for (int k = 0; k < 3 && ok; k++){
+        uint32_t *a = realloc(arrays[k], (len + 1) * sizeof(uint32_t));
+        if (a != NULL)
+          arrays[k] = a;
+        ok = a != NULL;
+      }
+      chars = arrays[0];
+      prev = arrays[1];
+      path = arrays[2];
+      if (!ok)
+        break;
+      cap = len;
     }
+
+    size_t count = 0;
+    for (size_t i = 0; i < len; )
+      chars[count++] = utf8_fold(utf8_next(prefix, len, &i));
+
+    // Prefixes sharing a stem with the previous one continue from the node of the stem.
+    size_t depth = 0;
+    while (depth < walked && depth < count && chars[depth] == prev[depth])
+      depth++;
+
+    uint32_t node = path[depth];
+    while (depth < count && (node = trie_child(t, node, chars[depth])) != NO_NODE)
+      path[++depth] = node;
+
+    walked = depth;
+    uint32_t *swap = prev;
+    prev = chars;
+    chars = swap;
+
+    print_index_answer(stdout, t, depth == count ? path[depth] : NO_NODE);
     printf("\n");
+  }
+
+  ok = ok && !r.error;
+  bool read = !reader_input_error(&r);
+  reader_free(&r);
+  free(chars);
+  free(prev);
+  free(path);
+  if (!ok)
+    fprintf(stderr, "Not enough memory for the batch.\n");
+  return ok && read;
+}
+
+#define SESSION_DEPTH 128 // initial number of typed characters the session has room for
+
+// State of the session mode - trie nodes of all prefixes of the typed text.
+typedef struct {
+  uint32_t *nodes; // nodes[i] - node of the first i typed characters or NO_NODE
+  size_t depth;    // number of typed characters
+  size_t cap;
+} session;
+
+// Function which appends a typed character, the new node is found among the children of the current one.
+bool session_type(const trie *t, session *s, uint32_t c)
+{
+  if (s->depth + 1 >= s->cap){
+    size_t new_cap = s->cap * 2;
+    uint32_t *nodes = realloc(s->nodes, new_cap * sizeof(uint32_t));
+    if (nodes == NULL)
+      return false;
+    s->nodes = nodes;
+    s->cap = new_cap;
+  }
+
+  uint32_t node = s->nodes[s->depth];
+  s->nodes[++s->depth] = (node == NO_NODE) ? NO_NODE : trie_child(t, node, utf8_fold(c));
+  return true;
+}
+
+/* Function which runs the session: every line of stdin is a command, "+TEXT" types the characters of TEXT,
+   "-" deletes the last typed character and "!" deletes everything. After each command, the answer for
+   the typed prefix is printed, followed by an empty line. */
+int session_answer(const trie *t)
+{
+  session s = {malloc(SESSION_DEPTH * sizeof(uint32_t)), 0, SESSION_DEPTH};
+  line_reader r;
+  char *command;
+  size_t len;
+
+  if (!reader_init(&r, stdin) || s.nodes == NULL){
+    fprintf(stderr, "Not enough memory for the session.\n");
+    reader_free(&r);
+    free(s.nodes);
     return 1;
   }
-  else if (char_available && (enabled_cities == 1)){
+  s.nodes[0] = 0; // the root - nothing typed yet
+
+  while (reader_next(&r, &command, &len)){
+    if (command[0] == '+'){
+      for (size_t i = 1; i < len; ){
+        if (!session_type(t, &s, utf8_next(command, len, &i))){
+          fprintf(stderr, "Not enough memory for the session.\n");
+          reader_free(&r);
+          free(s.nodes);
+          return 1;
+        }
+      }
+    }
+    else if (command[0] == '-' && len == 1){
+      if (s.depth > 0)
+        s.depth--;
+    }
+    else if (command[0] == '!' && len == 1)
+      s.depth = 0;
+    else {
+      fprintf(stderr, "Unknown command \"%s\", use +TEXT, - or !.\n", command);
+      continue;
+    }
+
+    print_index_answer(stdout, t, s.nodes[s.depth]);
+    printf("\n");
+    fflush(stdout);
+  }
+
+  bool ok = !r.error;
+  if (!ok)
+    fprintf(stderr, "Not enough memory for the session.\n");
+  ok = !reader_input_error(&r) && ok;
+  reader_free(&r);
+  free(s.nodes);
+  return ok ? 0 : 1;
+}
+
+// Function which opens the file with prefixes for the batch mode ("-" or none for stdin).
+FILE *open_prefixes(int argc, char* argv[])
+{
+  if (argc < 2 || strcmp(argv[1], "-") == 0)
+    return stdin;
+
+  FILE *f = fopen(argv[1], "r");
+  if (f == NULL)
+    fprintf(stderr, "The file with prefixes %s could not be opened.\n", argv[1]);
+  return f;
+}
+
+// Function which loads the database from stdin into a trie, prints an error message on failure.
+bool load_index(trie *t)
+{
+  bool loaded = trie_init(t);
+
+  if (!loaded)
+    fprintf(stderr, "Not enough memory to build the index of the database.\n");
+  else
+    loaded = build_index(t, stdin);
+  if (!loaded)
+    trie_free(t);
+  return loaded;
+}
+
+// Function which answers the input argument using a trie built from the database on stdin.
+int trie_mode(int argc, char* argv[])
+{
+  trie t;
+
+  if (!load_index(&t))
+    return 1;
+
+  answer_index(&t, argc, argv);
+  trie_free(&t);
+  return 0;
+}
+
+// Function which answers the input argument with typos allowed using a trie built from the database on stdin.
+int fuzzy_mode(int argc, char* argv[])
+{
+  trie t;
+
+  if (argc != 3){
+    fprintf(stderr, "Usage: --fuzzy K PREFIX < database\n");
+    return 1;
+  }
+  if (!load_index(&t))
+    return 1;
+
+  int ret = fuzzy_answer(&t, argc, argv);
+  trie_free(&t);
+  return ret;
+}
+
+// Function which prints the heaviest cities for the input argument using a trie built from the database on stdin.
+int top_mode(int argc, char* argv[])
+{
+  trie t;
+
+  if (argc != 3){
+    fprintf(stderr, "Usage: --top K PREFIX < database\n");
     return 1;
   }
+  if (!load_index(&t))
+    return 1;
+
+  int ret = top_answer(&t, argc, argv);
+  trie_free(&t);
+  return ret;
+}
+
+// Function which loads the database from a file into a DAWG, prints an error message on failure.
+bool build_dawg(dawg *d, FILE *db)
+{
+  line_reader r;
+  char *city;
+  size_t len;
+  bool ok = reader_init(&r, db);
+
+  while (ok && reader_next(&r, &city, &len))
+    ok = dawg_add(d, city, len);
+  ok = ok && !r.error;
+  bool read = !reader_input_error(&r);
+  reader_free(&r);
+  if (read && !(ok && dawg_finish(d))){
+    fprintf(stderr, "Not enough memory to build the index of the database.\n");
+    return false;
+  }
+  return read && ok;
+}
+
+// Function which returns the average number of bytes per line of the database.
+double bytes_per_entry(size_t bytes, uint32_t entries)
+{
+  return entries > 0 ? (double)bytes / entries : 0.0;
+}
+
+// Function which builds a DAWG from the database on stdin and saves it into the index file path.
+int build_dawg_mode(const char *path)
+{
+  dawg d;
+
+  dawg_init(&d);
+  if (!build_dawg(&d, stdin)){
+    dawg_free(&d);
+    return 1;
+  }
+
+  bool saved = dawg_save(&d, path);
+  if (saved)
+    printf("DAWG: %u entries, %u keys, %u states, %u transitions, %zu bytes (%.1f bytes per entry)\n",
+           (unsigned)d.line_count, (unsigned)d.word_count, (unsigned)d.state_count, (unsigned)d.trans_count,
+           dawg_bytes(&d), bytes_per_entry(dawg_bytes(&d), d.line_count));
   else
-    return 0;
+    fprintf(stderr, "The index file %s could not be written.\n", path);
+  dawg_free(&d);
+  return saved ? 0 : 1;
 }
 
-int main(int argc, char* argv[])
+// Function which builds a trie (or a DAWG with --dawg) from the database on stdin and saves it into the index file argv[1].
+int build_index_mode(int argc, char* argv[])
+{
+  trie t;
+
+  if (argc == 3 && strcmp(argv[2], "--dawg") == 0)
+    return build_dawg_mode(argv[1]);
+  if (argc != 2){
+    fprintf(stderr, "Usage: --build-index FILE [--dawg] < database\n");
+    return 1;
+  }
+  if (!load_index(&t))
+    return 1;
+
+  bool saved = trie_save(&t, argv[1]);
+  if (saved)
+    printf("Index: %u entries, %u nodes, %zu bytes (%.1f bytes per entry)\n", (unsigned)t.line_count,
+           (unsigned)t.node_count, trie_bytes(&t), bytes_per_entry(trie_bytes(&t), t.line_count));
+  else
+    fprintf(stderr, "The index file %s could not be written.\n", argv[1]);
+  trie_free(&t);
+  return saved ? 0 : 1;
+}
+
+// Function which prints why a query of a DAWG failed.
+void dawg_query_error(const dawg_answer *a)
+{
+  if (a->damaged)
+    fprintf(stderr, "The index file is damaged.\n");
+  else
+    fprintf(stderr, "Not enough memory to answer the query.\n");
+}
+
+// Function which prints the answer for a prefix computed on a DAWG, the same as print_index_answer() does.
+bool print_dawg_answer(const dawg *d, const char *prefix, size_t len)
 {
-  // Declaring or initializing the necessary variables.
   bool found_city = false;
-  int i, enabled_cities = 0;
-  char chars[28] = {0}, city[BUFSIZE], result[BUFSIZE]; // result - for storing the unique found result
+  dawg_answer a;
 
-  if (argc > 1){ // If an argument was set, search for matching results.
-    int len = string_length(argv[1]);
+  if (!dawg_query(d, prefix, len, &a)){
+    dawg_query_error(&a);
+    return false;
+  }
+  if (!a.found){
+    printf("Not found\n");
+    return true;
+  }
+
+  for (uint32_t i = 0; i < a.term_count; i++){
+    printf("Found: %s\n", dawg_line(d, a.term[i]));
+    found_city = true;
+  }
+  if (a.count == 1){
+    printf("Found: %s\n", dawg_line(d, a.unique));
+    found_city = true;
+  }
+
+  if (!(find_print_chars(stdout, a.enable, a.count)) && !(found_city))
+    printf("Not found\n");
+  free(a.term);
+  return true;
+}
+
+// Function which answers every prefix from a file using a DAWG, each answer is followed by an empty line.
+bool dawg_batch_answer(const dawg *d, FILE *prefixes)
+{
+  line_reader r;
+  char *prefix;
+  size_t len;
+  bool read = reader_init(&r, prefixes), answered = true;
+
+  while (read && answered && reader_next(&r, &prefix, &len)){
+    answered = print_dawg_answer(d, prefix, len);
+    printf("\n");
+  }
+  read = read && !r.error;
+  if (!read)
+    fprintf(stderr, "Not enough memory for the batch.\n");
+  read = !reader_input_error(&r) && read;
+  reader_free(&r);
+  return read && answered;
+}
+
+// Function which answers the input argument (argv[2]) or a batch using the DAWG index file argv[1].
+int dawg_index_mode(int argc, char* argv[])
+{
+  dawg d;
+  bool ok = true;
+
+  if (!dawg_map(&d, argv[1])){
+    fprintf(stderr, "The index file %s could not be opened or is not valid.\n", argv[1]);
+    return 1;
+  }
+
+  if (argc > 2 && strcmp(argv[2], "--batch") == 0){
+    FILE *prefixes = open_prefixes(argc - 2, argv + 2);
+    ok = prefixes != NULL && dawg_batch_answer(&d, prefixes);
+    if (prefixes != NULL && prefixes != stdin)
+      fclose(prefixes);
+  }
+  else if (argc > 2 && (strcmp(argv[2], "--session") == 0 || strcmp(argv[2], "--fuzzy") == 0
+                        || strcmp(argv[2], "--top") == 0 || strcmp(argv[2], "--check") == 0)){
+    fprintf(stderr, "%s is not supported by a DAWG index, build the index without --dawg.\n", argv[2]);
+    dawg_free(&d);
+    return 1;
+  }
+  else if (argc > 2){
+    errors(argc - 1);
+    ok = print_dawg_answer(&d, argv[2], string_length(argv[2]));
+  }
+  else { // Without an argument, only the characters available at the start are printed.
+    dawg_answer a;
+    if ((ok = dawg_query(&d, "", 0, &a))){
+      find_print_chars(stdout, a.enable, d.line_count);
+      free(a.term);
+    }
+    else
+      dawg_query_error(&a);
+  }
+
+  dawg_free(&d);
+  return ok ? 0 : 1;
+}
+
+// Function which answers the input argument (argv[2]) using the index file argv[1].
+int index_mode(int argc, char* argv[])
+{
+  trie t;
+
+  if (argc < 2){
+    fprintf(stderr, "Usage: --index FILE [PREFIX | --batch [FILE] | --session | --fuzzy K PREFIX | --top K PREFIX"
+                    " | --check]\n");
+    return 1;
+  }
+  if (!trie_map(&t, argv[1])) // it can be a DAWG index
+    return dawg_index_mode(argc, argv);
+
+  if (argc > 2 && strcmp(argv[2], "--check") == 0){
+    bool valid = trie_check(&t);
+    if (valid)
+      printf("The index file %s is valid.\n", argv[1]);
+    else
+      fprintf(stderr, "The index file %s is damaged.\n", argv[1]);
+    trie_free(&t);
+    return valid ? 0 : 1;
+  }
+
+  if (argc > 2 && strcmp(argv[2], "--session") == 0){
+    int ret = session_answer(&t);
+    trie_free(&t);
+    return ret;
+  }
+
+  if (argc > 2 && strcmp(argv[2], "--fuzzy") == 0){
+    int ret = fuzzy_answer(&t, argc - 2, argv + 2);
+    trie_free(&t);
+    return ret;
+  }
+
+  if (argc > 2 && strcmp(argv[2], "--top") == 0){
+    int ret = top_answer(&t, argc - 2, argv + 2);
+    trie_free(&t);
+    return ret;
+  }
+
+  if (argc > 2 && strcmp(argv[2], "--batch") == 0){
+    FILE *prefixes = open_prefixes(argc - 2, argv + 2);
+    bool answered = prefixes != NULL && batch_answer(&t, prefixes);
+    if (prefixes != NULL && prefixes != stdin)
+      fclose(prefixes);
+    trie_free(&t);
+    return answered ? 0 : 1;
+  }
+
+  answer_index(&t, argc - 1, argv + 1);
+  trie_free(&t);
+  return 0;
+}
+
+// Function which answers the prefixes from the file argv[1] using a trie built from the database on stdin.
+int batch_mode(int argc, char* argv[])
+{
+  trie t;
+
+  if (argc != 2 || strcmp(argv[1], "-") == 0){
+    fprintf(stderr, "Usage: --batch FILE < database\n");
+    return 1;
+  }
+
+  FILE *prefixes = open_prefixes(argc, argv);
+  if (prefixes == NULL)
+    return 1;
+  if (!load_index(&t)){
+    fclose(prefixes);
+    return 1;
+  }
+
+  bool answered = batch_answer(&t, prefixes);
+  fclose(prefixes);
+  trie_free(&t);
+  return answered ? 0 : 1;
+}
+
+// Function which runs a session with a trie built from the database file argv[1].
+int session_mode(int argc, char* argv[])
+{
+  trie t;
+
+  if (argc != 2){
+    fprintf(stderr, "Usage: --session DATABASE\n");
+    return 1;
+  }
+
+  FILE *db = fopen(argv[1], "r");
+  if (db == NULL){
+    fprintf(stderr, "The database %s could not be opened.\n", argv[1]);
+    return 1;
+  }
+  bool loaded = trie_init(&t);
+  if (!loaded)
+    fprintf(stderr, "Not enough memory to build the index of the database.\n");
+  else
+    loaded = build_index(&t, db);
+  fclose(db);
+  if (!loaded){
+    trie_free(&t);
+    return 1;
+  }
+
+  int ret = session_answer(&t);
+  trie_free(&t);
+  return ret;
+}
+
+/* Function which loads a trie for the daemon from an index file or, if it is not one, from a database file.
+   A DAWG index cannot be served by the daemon, which answers the prefixes from a trie. */
+bool daemon_load_file(trie *t, const char *path)
+{
+  uint32_t magic = 0;
+  FILE *db = fopen(path, "r");
+  if (db == NULL)
+    return false;
+
+  if (fread(&magic, sizeof(magic), 1, db) == 1 && (magic == INDEX_MAGIC || magic == DAWG_MAGIC)){
+    fclose(db);
+    if (magic == DAWG_MAGIC){
+      fprintf(stderr, "The daemon cannot serve the DAWG index %s, build the index without --dawg.\n", path);
+      return false;
+    }
+    return trie_map(t, path);
+  }
+
+  rewind(db);
+  bool loaded = trie_init(t) && build_index(t, db);
+  fclose(db);
+  if (!loaded)
+    trie_free(t);
+  return loaded;
+}
+
+// Function which answers a prefix for a client of the daemon, the same way as the batch mode does.
+void daemon_answer_prefix(FILE *out, const trie *t, const char *prefix, size_t len)
+{
+  print_index_answer(out, t, trie_find(t, prefix, len));
+}
+
+// Function which runs the daemon on the socket argv[1] with the database or index file argv[2].
+int daemon_mode(int argc, char* argv[])
+{
+  if (argc != 3){
+    fprintf(stderr, "Usage: --daemon SOCKET FILE\n");
+    return 1;
+  }
+  return daemon_run(argv[1], argv[2], daemon_load_file, daemon_answer_prefix);
+}
 
-      errors(argc, argv); // Input error detecting function
+/* Function which answers the input argument (argv[1], if set) by scanning the database on stdin with more threads.
+   Returns -1 if stdin is not a regular file which can be mapped, the sequential scan is used then. */
+int threads_mode(unsigned threads, int argc, char* argv[])
+{
+  const char *data;
+  size_t size;
+  scan_part parts[PSCAN_MAX_THREADS];
+  scan_prefix prefix;
 
-    // Load city names one by one from file to stdin.
-    while (fgets(city, BUFSIZE, stdin) != NULL){
-      bool equal = true;
-      i = 0;
+  if (!pscan_map(0, &data, &size))
+    return -1;
+  if (argc > 1){
+    errors(argc);
+    if (!scan_init(&prefix, argv[1], string_length(argv[1]))){
+      fprintf(stderr, "Not enough memory to read the database.\n");
+      pscan_unmap(data, size);
+      return 1;
+    }
+  }
 
-      /* Continue the cycle if the results match and there are still some characters
-         in the input argument and the city name. */
-      while (city[i] != '\n' && argv[1][i] != '\0' && i < len && equal == true){
-        if (!(letter_compare(city[i], argv[1][i])))
-          equal = false;
+  bool ok = pscan_run(data, size, (argc > 1) ? &prefix : NULL, threads, parts);
+  if (ok){
+    // The same output as the sequential scan, the parts are merged in the order of the database.
+    bool found_city = false;
+    int enabled_cities = 0;
+    uint64_t chars = 0;
+    const scan_part *first = NULL; // the part with the first city longer than the prefix
 
-        i++;
+    for (unsigned i = 0; i < threads; i++){
+      for (size_t j = 0; j < parts[i].found_count; j++){
+        printf("Found: %.*s\n", (int)parts[i].found[2*j+1], data + parts[i].found[2*j]);
+        found_city = true;
       }
+      if (first == NULL && parts[i].enabled_cities > 0)
+        first = &parts[i];
+      enabled_cities += parts[i].enabled_cities;
+      chars |= parts[i].chars;
+    }
+
+    if (argc > 1){
+      if (enabled_cities == 1){
+        printf("Found: %.*s\n", (int)first->first_len, data + first->first);
+        found_city = true;
+      }
+      if (!(find_print_chars(stdout, chars, enabled_cities)) && !(found_city))
+        printf("Not found\n");
+    }
+    else
+      find_print_chars(stdout, chars, enabled_cities);
+  }
+  else
+    fprintf(stderr, "Not enough memory to read the database.\n");
+
+  pscan_free(parts, threads);
+  if (argc > 1)
+    scan_free(&prefix);
+  pscan_unmap(data, size);
+  return ok ? 0 : 1;
+}
+
+int main(int argc, char* argv[])
+{
+  // Declaring or initializing the necessary variables.
+  bool found_city = false;
+  int enabled_cities = 0;
+  uint64_t chars = 0; // set of the available following characters
+  char *city, *result = NULL; // result - for storing the unique found result
+  size_t city_len, end;
+  line_reader r;
+  scan_prefix prefix;
+
+  if (argc > 1 && strcmp(argv[1], "--trie") == 0)
+    return trie_mode(argc - 1, argv + 1);
+  if (argc > 1 && strcmp(argv[1], "--build-index") == 0)
+    return build_index_mode(argc - 1, argv + 1);
+  if (argc > 1 && strcmp(argv[1], "--index") == 0)
+    return index_mode(argc - 1, argv + 1);
+  if (argc > 1 && strcmp(argv[1], "--batch") == 0)
+    return batch_mode(argc - 1, argv + 1);
+  if (argc > 1 && strcmp(argv[1], "--session") == 0)
+    return session_mode(argc - 1, argv + 1);
+  if (argc > 1 && strcmp(argv[1], "--fuzzy") == 0)
+    return fuzzy_mode(argc - 1, argv + 1);
+  if (argc > 1 && strcmp(argv[1], "--top") == 0)
+    return top_mode(argc - 1, argv + 1);
+  if (argc > 1 && strcmp(argv[1], "--daemon") == 0)
+    return daemon_mode(argc - 1, argv + 1);
+  if (argc > 1 && strcmp(argv[1], "--threads") == 0){
+    uint32_t threads;
+    if (argc < 3){
+      fprintf(stderr, "Usage: --threads N [PREFIX] < database\n");
+      return 1;
+    }
+    if (!option_number("--threads", argv[2], PSCAN_MAX_THREADS, &threads))
+      return 1;
+    int ret = threads_mode(threads, argc - 2, argv + 2);
+    if (ret >= 0)
+      return ret;
+    argc -= 2; // stdin cannot be mapped, so it is scanned by this thread
+    argv += 2;
+  }
 
-      /* If the results match, decide whether a city is found or there are some
+  if (!reader_init(&r, stdin)){
+    fprintf(stderr, "Not enough memory to read the database.\n");
+    return 1;
+  }
+
+  if (argc > 1){ // If an argument was set, search for matching results.
+    size_t len = string_length(argv[1]);
+
+      errors(argc); // Input error detecting function
+
+    if (!scan_init(&prefix, argv[1], len)){
+      fprintf(stderr, "Not enough memory to read the database.\n");
+      reader_free(&r);
+      return 1;
+    }
+
+    // Load city names one by one from stdin.
+    while (reader_next(&r, &city, &city_len)){
+      uint32_t weight; // only the name of the city is compared and printed
+      city_len = split_weight(city, city_len, &weight);
+      city[city_len] = '\0';
+
+      /* If the city starts with the input argument, decide whether a city is found or there are some
          characters that can be enabled. */
-      if (equal){
-        if (city[i] == '\n'){
-          printf("Found: %s", city);
-          found_city = true;
-        }
-        else if (city[i] == '\0'){ // For the last line in the city database file.
+      if (scan_match(&prefix, city, city_len, &end)){
+        if (end == city_len){
           printf("Found: %s\n", city);
           found_city = true;
         }
         else {
-          save_char(i, chars, city);
+          save_char(end, &chars, city, city_len);
 
           // If the current city is the first available option, store its name in case it is the only one.
-          if (enabled_cities == 0){
-            for (int j = 0; city[j] != '\0'; j++)
-              result[j] = city[j];
-          }
+          if (enabled_cities == 0 && (result = malloc(city_len + 1)) != NULL)
+            memcpy(result, city, city_len + 1);
           enabled_cities++;
         }
       }
     }
-    if (enabled_cities == 1){
-      printf("Found: %s", result);
+    if (enabled_cities == 1 && result != NULL){
+      printf("Found: %s\n", result);
       found_city = true;
     }
+    free(result);
+    scan_free(&prefix);
 
     // If no cities or available characters are found.
-    if (!(find_print_chars(chars, enabled_cities)) && !(found_city))
+    if (!(find_print_chars(stdout, chars, enabled_cities)) && !(found_city))
       printf("Not found\n");
 
   }
   else { // If no argument was set, search for available characters that lead to a result.
-    while(fgets(city, BUFSIZE, stdin)){
-      i = 0;
-      save_char(i, chars, city);
+    while (reader_next(&r, &city, &city_len)){
+      save_char(0, &chars, city, city_len);
       enabled_cities++;
     }
-    find_print_chars(chars, enabled_cities);
+    find_print_chars(stdout, chars, enabled_cities);
   }
 
-  return 0;
+  bool read = !r.error;
+  if (!read)
+    fprintf(stderr, "Not enough memory to read the database.\n");
+  read = !reader_input_error(&r) && read;
+  reader_free(&r);
+  return read ? 0 : 1;
 }
@@ -0,0 +1,175 @@
+/*
+ * File:          pscan.c
+ * Date:          05. 11. 2017
+ * Author:        Dominik Vecera, xvecer23@stud.fit.vutbr.cz
+ * Project:       Working with text
+ * Description:   Parallel scan of a database mapped into memory, see pscan.h.
+ */
+
+#define _POSIX_C_SOURCE 200809L // mmap, fstat
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "pscan.h"
+#include "index.h"
+#include "reader.h"
+#include "utf8.h"
+
+// Function which maps a regular file into memory, returns false if it is not possible (e.g. for a pipe).
+bool pscan_map(int fd, const char **data, size_t *size)
+{
+  struct stat st;
+
+  if (fstat(fd, &st) == -1 || !S_ISREG(st.st_mode))
+    return false;
+  *size = st.st_size;
+  if (*size == 0){ // an empty file cannot be mapped, but it is an empty database
+    *data = NULL;
+    return true;
+  }
+
+  void *map = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (map == MAP_FAILED)
+    return false;
+  *data = map;
+  return true;
+}
+
+// Function which unmaps a database mapped by pscan_map().
+void pscan_unmap(const char *data, size_t size)
+{
+  if (data != NULL)
+    munmap((void *)data, size);
+}
+
+// Function which appends a city equal to the prefix to the result of a part.
+static bool add_found(scan_part *p, size_t offset, size_t len)
+{
+  if (p->found_count == p->found_cap){
+    size_t new_cap = p->found_cap ? p->found_cap * 2 : 16;
+    size_t *found = realloc(p->found, new_cap * 2 * sizeof(size_t));
+    if (found == NULL)
+      return false;
+    p->found = found;
+    p->found_cap = new_cap;
+  }
+  p->found[2 * p->found_count] = offset;
+  p->found[2 * p->found_count + 1] = len;
+  p->found_count++;
+  return true;
+}
+
+/* Function which scans the lines of one part, it is the same as the loop in main(). The mapping is not
+   followed by READER_PAD readable bytes, so the lines at the very end of the file are copied first. */
+static void *scan_part_run(void *arg)
+{
+  scan_part *p = arg;
+  char *copy = NULL;
+  size_t pos = p->begin;
+
+  while (pos < p->end){
+    const char *line = p->data + pos;
+    const char *nl = memchr(line, '\n', p->end - pos);
+    size_t line_len = (nl != NULL) ? (size_t)(nl - line) : p->end - pos;
+    size_t offset = pos, end;
+    uint32_t weight;
+
+    pos += line_len + 1;
+    line_len = split_weight(line, line_len, &weight);
+
+    if (p->prefix == NULL){ // only the first character of every city
+      size_t i = 0;
+      int slot = (line_len > 0) ? enable_slot(utf8_next(line, line_len, &i)) : -1;
+      if (slot >= 0)
+        p->chars |= (uint64_t)1 << slot;
+      p->enabled_cities++;
+      continue;
+    }
+
+    if (offset + line_len + READER_PAD > p->size){
+      free(copy);
+      if ((copy = calloc(line_len + READER_PAD, 1)) == NULL){
+        p->error = true;
+        break;
+      }
+      memcpy(copy, line, line_len);
+      line = copy;
+    }
+
+    if (scan_match(p->prefix, line, line_len, &end)){
+      if (end == line_len){
+        if (!add_found(p, offset, line_len)){
+          p->error = true;
+          break;
+        }
+      }
+      else {
+        int slot = enable_slot(utf8_next(line, line_len, &end));
+        if (slot >= 0)
+          p->chars |= (uint64_t)1 << slot;
+        if (p->enabled_cities++ == 0){
+          p->first = offset;
+          p->first_len = line_len;
+        }
+      }
+    }
+  }
+
+  free(copy);
+  return NULL;
+}
+
+/* Function which scans a mapped database with the given number of threads and stores the results of the
+   parts into parts[0..threads). Returns false if there is not enough memory. */
+bool pscan_run(const char *data, size_t size, const scan_prefix *prefix, unsigned threads, scan_part *parts)
+{
+  pthread_t ids[PSCAN_MAX_THREADS];
+  bool started[PSCAN_MAX_THREADS];
+  size_t begin = 0;
+
+  // Every part but the first starts behind the first newline after its share of the bytes.
+  for (unsigned i = 0; i < threads; i++){
+    size_t end = (i + 1 == threads) ? size : size / threads * (i + 1);
+    if (end < begin)
+      end = begin;
+    const char *nl = (end < size) ? memchr(data + end, '\n', size - end) : NULL;
+    if (end < size)
+      end = (nl != NULL) ? (size_t)(nl - data) + 1 : size;
+
+    memset(&parts[i], 0, sizeof(scan_part));
+    parts[i].data = data;
+    parts[i].size = size;
+    parts[i].prefix = prefix;
+    parts[i].begin = begin;
+    parts[i].end = end;
+    begin = end;
+  }
+
+  // A part whose thread cannot be created is scanned by this thread.
+  for (unsigned i = 1; i < threads; i++)
+    started[i] = pthread_create(&ids[i], NULL, scan_part_run, &parts[i]) == 0;
+  scan_part_run(&parts[0]);
+  for (unsigned i = 1; i < threads; i++){
+    if (started[i])
+      pthread_join(ids[i], NULL);
+    else
+      scan_part_run(&parts[i]);
+  }
+
+  for (unsigned i = 0; i < threads; i++)
+    if (parts[i].error)
+      return false;
+  return true;
+}
+
+// Function which frees the results of the parts.
+void pscan_free(scan_part *parts, unsigned threads)
+{
+  for (unsigned i = 0; i < threads; i++){
+    free(parts[i].found);
+    parts[i].found = NULL;
+  }
+}
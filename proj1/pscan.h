@@ -0,0 +1,51 @@
+/*
+ * File:          pscan.h
+ * Date:          05. 11. 2017
+ * Author:        Dominik Vecera, xvecer23@stud.fit.vutbr.cz
+ * Project:       Working with text
+ * Description:   Parallel scan of a database mapped into memory. The database is split into parts on line
+ *                boundaries, every thread scans one part and the results of the parts are merged in their
+ *                order, so the answer is the same as the one of the sequential scan.
+ */
+
+#ifndef PSCAN_H
+#define PSCAN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "scan.h"
+
+#define PSCAN_MAX_THREADS 64
+
+// Result of the scan of one part of the database.
+typedef struct {
+  const char *data;          // the mapped database
+  size_t size;
+  const scan_prefix *prefix; // NULL if only the first characters are collected
+  size_t begin;              // bytes of the part
+  size_t end;
+  uint64_t chars;            // set of the available following characters
+  int enabled_cities;        // number of cities longer than the prefix
+  size_t first;              // the first city longer than the prefix (offset and length of its name)
+  size_t first_len;
+  size_t *found;             // offsets and lengths of the names of the cities equal to the prefix
+  size_t found_count;        // number of the cities (pairs in found)
+  size_t found_cap;
+  bool error;                // not enough memory
+} scan_part;
+
+// Function which maps a regular file into memory, returns false if it is not possible (e.g. for a pipe).
+bool pscan_map(int fd, const char **data, size_t *size);
+
+// Function which unmaps a database mapped by pscan_map().
+void pscan_unmap(const char *data, size_t size);
+
+/* Function which scans a mapped database with the given number of threads and stores the results of the
+   parts into parts[0..threads). Returns false if there is not enough memory. */
+bool pscan_run(const char *data, size_t size, const scan_prefix *prefix, unsigned threads, scan_part *parts);
+
+// Function which frees the results of the parts.
+void pscan_free(scan_part *parts, unsigned threads);
+
+#endif
@@ -0,0 +1,476 @@
+/*
+ * File:          qbench.c
+ * Date:          05. 11. 2017
+ * Author:        Dominik Vecera, xvecer23@stud.fit.vutbr.cz
+ * Project:       Working with text
+ * Description:   Benchmark of the ways of answering a prefix (make bench).
+ *                Usage: qbench DATABASE [QUERIES [SCAN_QUERIES]], qbench --header
+ *                The prefixes are the first 1 to MAX_PREFIX_CHARS characters of random lines of the database,
+ *                some of them in small letters and some of them missing in the database. Every prefix is answered
+ *                by the trie built from the database (trie), by its index file (index), by the DAWG index
+ *                file (dawg) and the first SCAN_QUERIES of them by the scan of the database (scan) and by the
+ *                parallel scan with a thread per processor (threads). All answers have to agree.
+ *                One CSV line is printed for every way: the time to build and to load the index,
+ *                the size of the index, percentiles of the latency of a query in microseconds and queries per second.
+ */
+
+#define _POSIX_C_SOURCE 200809L // clock_gettime, sysconf
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "index.h"
+#include "dawg.h"
+#include "reader.h"
+#include "scan.h"
+#include "pscan.h"
+#include "utf8.h"
+
+#define DEFAULT_QUERIES 10000
+#define DEFAULT_SCAN_QUERIES 20
+#define MAX_PREFIX_CHARS 6
+#define MISSING_RATE 20 // one prefix in MISSING_RATE is made of random letters
+
+// Summary of an answer which is the same for all ways of answering.
+typedef struct {
+  uint64_t enable;   // set of the available following characters
+  uint32_t count;    // number of cities longer than the prefix
+  uint32_t found;    // number of cities equal to the prefix
+} answer;
+
+// Prefixes of the benchmark.
+typedef struct {
+  char **text;
+  size_t *len;
+  size_t count;
+} query_set;
+
+// Database and numbers describing it.
+typedef struct {
+  const char *path;
+  FILE *f;
+  uint32_t entries;
+  size_t bytes;
+} database;
+
+typedef bool (*answer_fn)(const void *ctx, const char *prefix, size_t len, answer *a);
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+// Function which returns a pseudorandom number from 0 to n-1 (xorshift64*).
+uint64_t random_below(uint64_t n)
+{
+  rng_state ^= rng_state >> 12;
+  rng_state ^= rng_state << 25;
+  rng_state ^= rng_state >> 27;
+  return (rng_state * 0x2545F4914F6CDD1DULL >> 11) % n;
+}
+
+// Function which returns the time in nanoseconds.
+uint64_t now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+// Function which makes a prefix typed by the user from a city, returns NULL if there is not enough memory.
+char *make_prefix(const char *city, size_t city_len, size_t *len)
+{
+  size_t chars = 1 + random_below(MAX_PREFIX_CHARS);
+  bool small = random_below(2) == 0;
+  size_t i = 0;
+
+  city_len = split_weight(city, city_len, &(uint32_t){0});
+  for (size_t c = 0; c < chars && i < city_len; c++)
+    utf8_next(city, city_len, &i);
+
+  char *prefix = malloc(i + 1);
+  if (prefix == NULL)
+    return NULL;
+  for (size_t j = 0; j < i; j++)
+    prefix[j] = (small && city[j] >= 'A' && city[j] <= 'Z') ? city[j] + ('a' - 'A') : city[j];
+  prefix[i] = '\0';
+  *len = i;
+  return prefix;
+}
+
+// Function which picks the prefixes from random lines of the database and counts its lines.
+bool sample_queries(database *db, query_set *q, size_t max)
+{
+  line_reader r;
+  char *city;
+  size_t city_len;
+
+  q->count = 0;
+  q->text = malloc(max * sizeof(*q->text));
+  q->len = malloc(max * sizeof(*q->len));
+  if (q->text == NULL || q->len == NULL || !reader_init(&r, db->f))
+    return false;
+
+  // Reservoir sampling, so every line has the same chance and common prefixes are common among the queries.
+  db->entries = 0;
+  db->bytes = 0;
+  while (reader_next(&r, &city, &city_len)){
+    uint64_t slot = (q->count < max) ? q->count : random_below((uint64_t)db->entries + 1);
+    db->entries++;
+    db->bytes += city_len + 1;
+    if (slot >= max)
+      continue;
+
+    size_t len;
+    char *prefix = make_prefix(city, city_len, &len);
+    if (prefix == NULL){
+      reader_free(&r);
+      return false;
+    }
+    if (q->count == max)
+      free(q->text[slot]);
+    else
+      q->count++;
+    q->text[slot] = prefix;
+    q->len[slot] = len;
+  }
+  bool ok = !r.error && !reader_input_error(&r);
+  reader_free(&r);
+
+  for (size_t i = 0; ok && i < q->count; i += MISSING_RATE){
+    for (size_t j = 0; j < q->len[i]; j++)
+      q->text[i][j] = "QWXY"[random_below(4)];
+  }
+  return ok;
+}
+
+// Function which frees the prefixes.
+void free_queries(query_set *q)
+{
+  for (size_t i = 0; i < q->count; i++)
+    free(q->text[i]);
+  free(q->text);
+  free(q->len);
+}
+
+// Function which answers a prefix from a trie node, the same as print_index_answer() in proj1.c.
+bool trie_answer(const void *ctx, const char *prefix, size_t len, answer *a)
+{
+  const trie *t = ctx;
+  uint32_t node = trie_find(t, prefix, len);
+
+  *a = (answer){0, 0, 0};
+  if (node == NO_NODE)
+    return true;
+  a->enable = t->nodes[node].enable;
+  a->count = t->nodes[node].count;
+  for (uint32_t line = trie_term(t, node); line != NO_LINE; line = trie_next_line(t, line))
+    a->found++;
+  return true;
+}
+
+// Function which answers a prefix using a DAWG.
+bool dawg_summary(const void *ctx, const char *prefix, size_t len, answer *a)
+{
+  dawg_answer d;
+
+  *a = (answer){0, 0, 0};
+  if (!dawg_query(ctx, prefix, len, &d))
+    return false;
+  if (d.found)
+    *a = (answer){d.enable, d.count, d.term_count};
+  free(d.term);
+  return true;
+}
+
+// Function which answers a prefix by reading the whole database file, as proj1 without an index does.
+bool scan_answer(const void *ctx, const char *prefix, size_t len, answer *a)
+{
+  FILE *f = (FILE *)ctx;
+  scan_prefix p;
+  line_reader r;
+  char *city;
+  size_t city_len, end;
+
+  *a = (answer){0, 0, 0};
+  rewind(f);
+  if (!scan_init(&p, prefix, len))
+    return false;
+  if (!reader_init(&r, f)){
+    scan_free(&p);
+    return false;
+  }
+  while (reader_next(&r, &city, &city_len)){
+    city_len = split_weight(city, city_len, &(uint32_t){0});
+    if (scan_match(&p, city, city_len, &end)){
+      if (end == city_len)
+        a->found++;
+      else {
+        int slot = enable_slot(utf8_next(city, city_len, &end));
+        if (slot >= 0)
+          a->enable |= (uint64_t)1 << slot;
+        a->count++;
+      }
+    }
+  }
+  bool ok = !r.error && !reader_input_error(&r);
+  reader_free(&r);
+  scan_free(&p);
+  return ok;
+}
+
+// Mapped database for the parallel scan.
+typedef struct {
+  const char *data;
+  size_t size;
+  unsigned threads;
+} mapped_db;
+
+// Function which answers a prefix by the parallel scan of the mapped database.
+bool threads_answer(const void *ctx, const char *prefix, size_t len, answer *a)
+{
+  const mapped_db *m = ctx;
+  scan_part parts[PSCAN_MAX_THREADS];
+  scan_prefix p;
+
+  *a = (answer){0, 0, 0};
+  if (!scan_init(&p, prefix, len))
+    return false;
+  bool ok = pscan_run(m->data, m->size, &p, m->threads, parts);
+  for (unsigned i = 0; ok && i < m->threads; i++){
+    a->enable |= parts[i].chars;
+    a->count += parts[i].enabled_cities;
+    a->found += parts[i].found_count;
+  }
+  pscan_free(parts, m->threads);
+  scan_free(&p);
+  return ok;
+}
+
+int compare_times(const void *a, const void *b)
+{
+  uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+  return (x > y) - (x < y);
+}
+
+// Function which returns the percentile p of sorted times in microseconds (nearest rank).
+double percentile(const uint64_t *ns, size_t count, double p)
+{
+  size_t rank = (size_t)(p * count + 0.999999);
+  return ns[(rank > 0 ? rank : 1) - 1] / 1000.0;
+}
+
+/* Function which times the answers of the first count prefixes and prints the CSV line of the way mode.
+   The answers are stored into expected if check is false, otherwise they are compared with it. */
+bool run_mode(const char *mode, answer_fn ask, const void *ctx, const query_set *q, size_t count,
+              answer *expected, bool check, const database *db, double build_ms, double load_ms, size_t index_bytes)
+{
+  uint64_t *ns = malloc((count > 0 ? count : 1) * sizeof(*ns));
+  uint64_t total = 0;
+  answer a;
+
+  if (ns == NULL){
+    fprintf(stderr, "Not enough memory for the benchmark.\n");
+    return false;
+  }
+  for (size_t i = 0; i < count; i++){
+    uint64_t start = now_ns();
+    if (!ask(ctx, q->text[i], q->len[i], &a)){
+      fprintf(stderr, "The prefix %s could not be answered by %s.\n", q->text[i], mode);
+      free(ns);
+      return false;
+    }
+    ns[i] = now_ns() - start;
+    total += ns[i];
+    if (!check)
+      expected[i] = a;
+    else if (a.enable != expected[i].enable || a.count != expected[i].count || a.found != expected[i].found){
+      fprintf(stderr, "The answer of %s for the prefix %s differs from the trie.\n", mode, q->text[i]);
+      free(ns);
+      return false;
+    }
+  }
+
+  qsort(ns, count, sizeof(*ns), compare_times);
+  printf("%s,%u,%zu,%zu,%.1f,%.1f,%zu,%.2f,%.2f,%.2f,%.2f,%.0f\n", mode, (unsigned)db->entries, db->bytes, count,
+         build_ms, load_ms, index_bytes, count ? percentile(ns, count, 0.5) : 0.0,
+         count ? percentile(ns, count, 0.9) : 0.0, count ? percentile(ns, count, 0.99) : 0.0,
+         count ? ns[count - 1] / 1000.0 : 0.0, total ? count * 1e9 / total : 0.0);
+  fflush(stdout);
+  free(ns);
+  return true;
+}
+
+// Function which loads the database file into a trie.
+bool build_trie(trie *t, FILE *f)
+{
+  line_reader r;
+  char *city;
+  size_t len;
+
+  rewind(f);
+  if (!trie_init(t))
+    return false;
+  if (!reader_init(&r, f)){
+    trie_free(t);
+    return false;
+  }
+  bool ok = true;
+  while (ok && reader_next(&r, &city, &len))
+    ok = trie_add(t, city, len);
+  ok = ok && !r.error && !reader_input_error(&r) && trie_rank(t);
+  reader_free(&r);
+  if (!ok)
+    trie_free(t);
+  return ok;
+}
+
+// Function which loads the database file into a DAWG.
+bool build_dawg(dawg *d, FILE *f)
+{
+  line_reader r;
+  char *city;
+  size_t len;
+
+  rewind(f);
+  dawg_init(d);
+  if (!reader_init(&r, f))
+    return false;
+  bool ok = true;
+  while (ok && reader_next(&r, &city, &len))
+    ok = dawg_add(d, city, len);
+  ok = ok && !r.error && !reader_input_error(&r) && dawg_finish(d);
+  reader_free(&r);
+  if (!ok)
+    dawg_free(d);
+  return ok;
+}
+
+// Function which benchmarks the trie, its index file and the DAWG index file, the answers are stored into expected.
+bool run_indexes(const database *db, const query_set *q, answer *expected)
+{
+  char path[4096];
+  trie t;
+  dawg d;
+  uint64_t start = now_ns();
+
+  if (!build_trie(&t, db->f)){
+    fprintf(stderr, "Not enough memory to build the index of the database.\n");
+    return false;
+  }
+  double build_ms = (now_ns() - start) / 1e6;
+  size_t bytes = trie_bytes(&t);
+  bool ok = run_mode("trie", trie_answer, &t, q, q->count, expected, false, db, build_ms, 0.0, bytes);
+
+  snprintf(path, sizeof(path), "%s.idx", db->path);
+  ok = ok && trie_save(&t, path);
+  trie_free(&t);
+  if (ok){
+    start = now_ns();
+    ok = trie_map(&t, path);
+    if (ok){
+      ok = run_mode("index", trie_answer, &t, q, q->count, expected, true, db, build_ms,
+                    (now_ns() - start) / 1e6, bytes);
+      trie_free(&t);
+    }
+  }
+  if (!ok)
+    return false;
+
+  start = now_ns();
+  if (!build_dawg(&d, db->f)){
+    fprintf(stderr, "Not enough memory to build the index of the database.\n");
+    return false;
+  }
+  build_ms = (now_ns() - start) / 1e6;
+  bytes = dawg_bytes(&d);
+  snprintf(path, sizeof(path), "%s.dawg", db->path);
+  ok = dawg_save(&d, path);
+  dawg_free(&d);
+  if (ok){
+    start = now_ns();
+    ok = dawg_map(&d, path);
+    if (ok){
+      ok = run_mode("dawg", dawg_summary, &d, q, q->count, expected, true, db, build_ms,
+                    (now_ns() - start) / 1e6, bytes);
+      dawg_free(&d);
+    }
+  }
+  return ok;
+}
+
+// Function which benchmarks the scan and the parallel scan of the database with the first count prefixes.
+bool run_scans(const database *db, const query_set *q, size_t count, answer *expected)
+{
+  mapped_db m;
+  answer a;
+
+  if (!scan_answer(db->f, "", 0, &a)) // the database is read once before, so it is in the page cache
+    return false;
+  if (!run_mode("scan", scan_answer, db->f, q, count, expected, true, db, 0.0, 0.0, 0))
+    return false;
+
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  m.threads = (cpus < 1) ? 1 : (cpus > PSCAN_MAX_THREADS) ? PSCAN_MAX_THREADS : (unsigned)cpus;
+  uint64_t start = now_ns();
+  if (!pscan_map(fileno(db->f), &m.data, &m.size))
+    return false;
+  bool ok = run_mode("threads", threads_answer, &m, q, count, expected, true, db, 0.0, (now_ns() - start) / 1e6, 0);
+  pscan_unmap(m.data, m.size);
+  return ok;
+}
+
+// Function which reads a count of queries from an argument.
+bool query_count(const char *arg, size_t *count)
+{
+  char *end;
+  long n = strtol(arg, &end, 10);
+
+  if (*end != '\0' || n < 1){
+    fprintf(stderr, "The number of queries %s has to be a positive number.\n", arg);
+    return false;
+  }
+  *count = n;
+  return true;
+}
+
+int main(int argc, char* argv[])
+{
+  database db;
+  query_set q;
+  size_t queries = DEFAULT_QUERIES, scan_queries = DEFAULT_SCAN_QUERIES;
+
+  if (argc == 2 && strcmp(argv[1], "--header") == 0){
+    printf("mode,entries,bytes,queries,build_ms,load_ms,index_bytes,p50_us,p90_us,p99_us,max_us,queries_per_s\n");
+    return 0;
+  }
+  if (argc < 2 || argc > 4){
+    fprintf(stderr, "Usage: qbench DATABASE [QUERIES [SCAN_QUERIES]], qbench --header\n");
+    return 1;
+  }
+  if ((argc > 2 && !query_count(argv[2], &queries)) || (argc > 3 && !query_count(argv[3], &scan_queries)))
+    return 1;
+
+  db.path = argv[1];
+  if ((db.f = fopen(db.path, "r")) == NULL){
+    fprintf(stderr, "The database %s could not be opened.\n", db.path);
+    return 1;
+  }
+  if (!sample_queries(&db, &q, queries)){
+    fprintf(stderr, "Not enough memory to read the database.\n");
+    free_queries(&q);
+    fclose(db.f);
+    return 1;
+  }
+
+  answer *expected = malloc((q.count > 0 ? q.count : 1) * sizeof(*expected));
+  bool ok = expected != NULL && run_indexes(&db, &q, expected) &&
+            run_scans(&db, &q, scan_queries < q.count ? scan_queries : q.count, expected);
+
+  free(expected);
+  free_queries(&q);
+  fclose(db.f);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,112 @@
+/*
+ * File:          reader.c
+ * Date:          05. 11. 2017
+ * Author:        Dominik Vecera, xvecer23@stud.fit.vutbr.cz
+ * Project:       Working with text
+ * Description:   Reading of lines of any length, see reader.h.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "reader.h"
+
+// Function which prepares reading lines from a file.
+bool reader_init(line_reader *r, FILE *f)
+{
+  r->f = f;
+  r->cap = READER_BLOCK;
+  r->start = 0;
+  r->end = 0;
+  r->eof = false;
+  r->error = false;
+  r->read_errno = 0;
+  r->buf = malloc(r->cap + READER_PAD);
+  return r->buf != NULL;
+}
+
+// Function which frees the buffer of a reader.
+void reader_free(line_reader *r)
+{
+  free(r->buf);
+  r->buf = NULL;
+}
+
+// Function which reads the next block of the file behind the unfinished line, returns false if nothing was read.
+static bool fill(line_reader *r)
+{
+  // Move the unfinished line to the start of the buffer, or make the buffer larger if it fills it all.
+  if (r->start > 0){
+    memmove(r->buf, r->buf + r->start, r->end - r->start);
+    r->end -= r->start;
+    r->start = 0;
+  }
+  else if (r->end + 1 >= r->cap){
+    char *buf = realloc(r->buf, r->cap * 2 + READER_PAD);
+    if (buf == NULL){
+      r->error = true;
+      return false;
+    }
+    r->buf = buf;
+    r->cap *= 2;
+  }
+
+  /* One byte is always kept free for the '\0' after the last line. read() returns whatever is available,
+     so a line typed on a terminal is answered at once instead of waiting for the whole block. */
+  ssize_t n;
+  do
+    n = read(fileno(r->f), r->buf + r->end, r->cap - 1 - r->end);
+  while (n < 0 && errno == EINTR);
+
+  if (n <= 0){ // a read error ends the input too, but it is kept to be reported
+    if (n < 0)
+      r->read_errno = errno;
+    r->eof = true;
+    return false;
+  }
+  r->end += n;
+  return true;
+}
+
+/* Function which returns the next line (without the newline, terminated by '\0') and its length.
+   The line stays valid until the next call, false is returned at the end of the file. */
+bool reader_next(line_reader *r, char **line, size_t *len)
+{
+  size_t searched = r->start; // characters before this one are known not to be newlines
+
+  while (true){
+    char *nl = memchr(r->buf + searched, '\n', r->end - searched);
+    if (nl != NULL){
+      *line = r->buf + r->start;
+      *len = nl - *line;
+      *nl = '\0';
+      r->start = nl + 1 - r->buf;
+      return true;
+    }
+
+    searched = r->end - r->start;
+    if (r->eof || !fill(r)){
+      if (r->error || r->read_errno != 0 || r->start == r->end)
+        return false;
+      // The last line without a newline.
+      *line = r->buf + r->start;
+      *len = r->end - r->start;
+      (*line)[*len] = '\0';
+      r->start = r->end;
+      return true;
+    }
+  }
+}
+
+// Function which prints an error message if reading ended because the file could not be read, returns true then.
+bool reader_input_error(const line_reader *r)
+{
+  if (r->read_errno == 0)
+    return false;
+  fprintf(stderr, "The input could not be read: %s\n", strerror(r->read_errno));
+  return true;
+}
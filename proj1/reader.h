@@ -0,0 +1,45 @@
+/*
+ * File:          reader.h
+ * Date:          05. 11. 2017
+ * Author:        Dominik Vecera, xvecer23@stud.fit.vutbr.cz
+ * Project:       Working with text
+ * Description:   Reading of lines of any length. The input is read in large blocks and the lines are
+ *                split inside the buffer, so they are not copied anywhere.
+ */
+
+#ifndef READER_H
+#define READER_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define READER_BLOCK (1 << 16) // initial size of the buffer, it grows for longer lines
+#define READER_PAD 32 // bytes which can be read after the end of every line (by vector loads in scan.c)
+
+// State of reading lines from a file.
+typedef struct {
+  FILE *f;
+  char *buf;
+  size_t cap;   // size of buf
+  size_t start; // first character of the next line
+  size_t end;   // end of the data read into buf
+  bool eof;     // the whole file has been read into buf
+  bool error;   // reading ended because of a missing memory
+  int read_errno; // errno of the read() which failed and ended reading, 0 if the file was read to its end
+} line_reader;
+
+// Function which prepares reading lines from a file.
+bool reader_init(line_reader *r, FILE *f);
+
+// Function which frees the buffer of a reader.
+void reader_free(line_reader *r);
+
+/* Function which returns the next line (without the newline, terminated by '\0') and its length.
+   The line stays valid until the next call, false is returned at the end of the file. */
+bool reader_next(line_reader *r, char **line, size_t *len);
+
+// Function which prints an error message if reading ended because the file could not be read, returns true then.
+bool reader_input_error(const line_reader *r);
+
+#endif
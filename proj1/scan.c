@@ -0,0 +1,149 @@
+/*
+ * File:          scan.c
+ * Date:          05. 11. 2017
+ * Author:        Dominik Vecera, xvecer23@stud.fit.vutbr.cz
+ * Project:       Working with text
+ * Description:   Comparison of the input prefix with the lines of the database, see scan.h.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "scan.h"
+#include "utf8.h"
+#include "reader.h"
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#ifdef __AVX2__
+#define SCAN_WIDTH 32
+#else
+#define SCAN_WIDTH 16
+#endif
+
+#if SCAN_WIDTH > READER_PAD
+#error "READER_PAD has to cover one vector load"
+#endif
+
+// Function which folds the prefix, returns false if there is not enough memory.
+bool scan_init(scan_prefix *p, const char *prefix, size_t len)
+{
+  size_t padded = (len / SCAN_WIDTH + 1) * SCAN_WIDTH;
+
+  p->len = len;
+  p->ascii = true;
+  p->count = 0;
+  p->folded = calloc(padded, 1);
+  p->chars = malloc((len + 1) * sizeof(uint32_t));
+  if (p->folded == NULL || p->chars == NULL){
+    scan_free(p);
+    return false;
+  }
+
+  for (size_t i = 0; i < len; i++){
+    p->folded[i] = utf8_fold((unsigned char)prefix[i]);
+    if ((unsigned char)prefix[i] >= 0x80)
+      p->ascii = false;
+  }
+  for (size_t i = 0; i < len; )
+    p->chars[p->count++] = utf8_fold(utf8_next(prefix, len, &i));
+  return true;
+}
+
+// Function which frees the folded prefix.
+void scan_free(scan_prefix *p)
+{
+  free(p->folded);
+  free(p->chars);
+  p->folded = NULL;
+  p->chars = NULL;
+}
+
+#if defined(__AVX2__)
+
+/* Function which compares SCAN_WIDTH bytes of a line with the folded prefix and returns the bitmask
+   of the equal ones, *high is set to the bitmask of the bytes which are not ASCII. Small letters are
+   found by two signed comparisons (bytes above 127 are negative, so they are never folded) and 0x20
+   is subtracted from them. */
+static unsigned equal_mask(const char *line, const unsigned char *folded, unsigned *high)
+{
+  __m256i c = _mm256_loadu_si256((const __m256i *)line);
+  *high = (unsigned)_mm256_movemask_epi8(c);
+  __m256i lower = _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('a' - 1)),
+                                   _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), c));
+  c = _mm256_sub_epi8(c, _mm256_and_si256(lower, _mm256_set1_epi8(' ')));
+  __m256i eq = _mm256_cmpeq_epi8(c, _mm256_loadu_si256((const __m256i *)folded));
+  return (unsigned)_mm256_movemask_epi8(eq);
+}
+
+#elif defined(__SSE2__)
+
+// Function which compares SCAN_WIDTH bytes of a line with the folded prefix, see the AVX2 version.
+static unsigned equal_mask(const char *line, const unsigned char *folded, unsigned *high)
+{
+  __m128i c = _mm_loadu_si128((const __m128i *)line);
+  *high = (unsigned)_mm_movemask_epi8(c);
+  __m128i lower = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('a' - 1)),
+                                _mm_cmpgt_epi8(_mm_set1_epi8('z' + 1), c));
+  c = _mm_sub_epi8(c, _mm_and_si128(lower, _mm_set1_epi8(' ')));
+  __m128i eq = _mm_cmpeq_epi8(c, _mm_loadu_si128((const __m128i *)folded));
+  return (unsigned)_mm_movemask_epi8(eq);
+}
+
+#else
+
+// Function which compares SCAN_WIDTH bytes of a line with the folded prefix one by one.
+static unsigned equal_mask(const char *line, const unsigned char *folded, unsigned *high)
+{
+  unsigned mask = 0;
+  *high = 0;
+  for (int i = 0; i < SCAN_WIDTH; i++){
+    unsigned char c = line[i];
+    if (c >= 0x80)
+      *high |= 1u << i;
+    else if (utf8_fold(c) == folded[i])
+      mask |= 1u << i;
+  }
+  return mask;
+}
+
+#endif
+
+// Function which compares the line with the prefix character by character, decoding and folding both.
+static bool match_chars(const scan_prefix *p, const char *line, size_t line_len, size_t *end)
+{
+  size_t i = 0;
+
+  for (size_t k = 0; k < p->count; k++){
+    if (i >= line_len || utf8_fold(utf8_next(line, line_len, &i)) != p->chars[k])
+      return false;
+  }
+  *end = i;
+  return true;
+}
+
+/* Function which finds out if a line starts with the prefix, *end is set to the byte of the line behind it.
+   At least READER_PAD bytes after the end of the line have to be readable. */
+bool scan_match(const scan_prefix *p, const char *line, size_t line_len, size_t *end)
+{
+  if (!p->ascii)
+    return match_chars(p, line, line_len, end);
+  if (line_len < p->len)
+    return false;
+
+  /* While the compared part of the line is ASCII, one byte is one character and the vectors decide.
+     Only the bytes of the prefix are compared in its last vector. */
+  for (size_t i = 0; i < p->len; i += SCAN_WIDTH){
+    size_t n = (p->len - i < SCAN_WIDTH) ? p->len - i : SCAN_WIDTH;
+    unsigned want = (unsigned)(((uint64_t)1 << n) - 1), high;
+    unsigned equal = equal_mask(line + i, p->folded + i, &high);
+
+    if (high & want)
+      return match_chars(p, line, line_len, end);
+    if ((equal & want) != want)
+      return false;
+  }
+  *end = p->len;
+  return true;
+}
@@ -0,0 +1,38 @@
+/*
+ * File:          scan.h
+ * Date:          05. 11. 2017
+ * Author:        Dominik Vecera, xvecer23@stud.fit.vutbr.cz
+ * Project:       Working with text
+ * Description:   Comparison of the input prefix with the lines of the database without case and diacritics,
+ *                used when there is no index. The prefix is folded once and the lines are compared with it
+ *                16 (SSE2) or 32 (AVX2, when built with -mavx2) bytes at a time while both are ASCII.
+ *                Only the lines with other characters in the compared part are decoded and folded by utf8.c.
+ */
+
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Input prefix prepared for the comparison.
+typedef struct {
+  unsigned char *folded; // the prefix with small letters a-z folded to capital ones, padded by zeros
+  size_t len;
+  bool ascii;            // the prefix contains only ASCII characters
+  uint32_t *chars;       // the folded characters of the prefix
+  size_t count;          // number of characters of the prefix
+} scan_prefix;
+
+// Function which folds the prefix, returns false if there is not enough memory.
+bool scan_init(scan_prefix *p, const char *prefix, size_t len);
+
+// Function which frees the folded prefix.
+void scan_free(scan_prefix *p);
+
+/* Function which finds out if a line starts with the prefix, *end is set to the byte of the line behind it.
+   At least READER_PAD bytes after the end of the line have to be readable. */
+bool scan_match(const scan_prefix *p, const char *line, size_t line_len, size_t *end);
+
+#endif
@@ -0,0 +1,148 @@
+/*
+ * File:          utf8.c
+ * Date:          05. 11. 2017
+ * Author:        Dominik Vecera, xvecer23@stud.fit.vutbr.cz
+ * Project:       Working with text
+ * Description:   Decoding of UTF-8 and folding of characters, see utf8.h.
+ */
+
+#include "utf8.h"
+
+// Texts of the characters of the Enable alphabet in the order of the output.
+const char *const enable_chars[ENABLE_SLOTS] = {
+  "A", "B", "C", "D", "E", "F", "G", "H", "I", "J", "K", "L", "M", "N", "O", "P", "Q", "R", "S",
+  "T", "U", "V", "W", "X", "Y", "Z", " ", "-",
+  "Á", "Č", "Ď", "É", "Ě", "Í", "Ň", "Ó", "Ř", "Š", "Ť", "Ú", "Ů", "Ý", "Ž"
+};
+
+/* Characters folded to capital letters without diacritics, generated from the Unicode decompositions
+   (Đ, Ħ, Ŀ, Ł, Ŧ and Ø have none and are folded by hand). */
+static const uint16_t fold_table[FOLD_TABLE_SIZE] = {
+  0x000, 0x001, 0x002, 0x003, 0x004, 0x005, 0x006, 0x007, 0x008, 0x009, 0x00A, 0x00B,
+  0x00C, 0x00D, 0x00E, 0x00F, 0x010, 0x011, 0x012, 0x013, 0x014, 0x015, 0x016, 0x017,
+  0x018, 0x019, 0x01A, 0x01B, 0x01C, 0x01D, 0x01E, 0x01F, 0x020, 0x021, 0x022, 0x023,
+  0x024, 0x025, 0x026, 0x027, 0x028, 0x029, 0x02A, 0x02B, 0x02C, 0x02D, 0x02E, 0x02F,
+  0x030, 0x031, 0x032, 0x033, 0x034, 0x035, 0x036, 0x037, 0x038, 0x039, 0x03A, 0x03B,
+  0x03C, 0x03D, 0x03E, 0x03F, 0x040, 0x041, 0x042, 0x043, 0x044, 0x045, 0x046, 0x047,
+  0x048, 0x049, 0x04A, 0x04B, 0x04C, 0x04D, 0x04E, 0x04F, 0x050, 0x051, 0x052, 0x053,
+  0x054, 0x055, 0x056, 0x057, 0x058, 0x059, 0x05A, 0x05B, 0x05C, 0x05D, 0x05E, 0x05F,
+  0x060, 0x041, 0x042, 0x043, 0x044, 0x045, 0x046, 0x047, 0x048, 0x049, 0x04A, 0x04B,
+  0x04C, 0x04D, 0x04E, 0x04F, 0x050, 0x051, 0x052, 0x053, 0x054, 0x055, 0x056, 0x057,
+  0x058, 0x059, 0x05A, 0x07B, 0x07C, 0x07D, 0x07E, 0x07F, 0x080, 0x081, 0x082, 0x083,
+  0x084, 0x085, 0x086, 0x087, 0x088, 0x089, 0x08A, 0x08B, 0x08C, 0x08D, 0x08E, 0x08F,
+  0x090, 0x091, 0x092, 0x093, 0x094, 0x095, 0x096, 0x097, 0x098, 0x099, 0x09A, 0x09B,
+  0x09C, 0x09D, 0x09E, 0x09F, 0x0A0, 0x0A1, 0x0A2, 0x0A3, 0x0A4, 0x0A5, 0x0A6, 0x0A7,
+  0x0A8, 0x0A9, 0x0AA, 0x0AB, 0x0AC, 0x0AD, 0x0AE, 0x0AF, 0x0B0, 0x0B1, 0x0B2, 0x0B3,
+  0x0B4, 0x0B5, 0x0B6, 0x0B7, 0x0B8, 0x0B9, 0x0BA, 0x0BB, 0x0BC, 0x0BD, 0x0BE, 0x0BF,
+  0x041, 0x041, 0x041, 0x041, 0x041, 0x041, 0x0C6, 0x043, 0x045, 0x045, 0x045, 0x045,
+  0x049, 0x049, 0x049, 0x049, 0x0D0, 0x04E, 0x04F, 0x04F, 0x04F, 0x04F, 0x04F, 0x0D7,
+  0x04F, 0x055, 0x055, 0x055, 0x055, 0x059, 0x0DE, 0x0DF, 0x041, 0x041, 0x041, 0x041,
+  0x041, 0x041, 0x0C6, 0x043, 0x045, 0x045, 0x045, 0x045, 0x049, 0x049, 0x049, 0x049,
+  0x0D0, 0x04E, 0x04F, 0x04F, 0x04F, 0x04F, 0x04F, 0x0F7, 0x04F, 0x055, 0x055, 0x055,
+  0x055, 0x059, 0x0DE, 0x059, 0x041, 0x041, 0x041, 0x041, 0x041, 0x041, 0x043, 0x043,
+  0x043, 0x043, 0x043, 0x043, 0x043, 0x043, 0x044, 0x044, 0x044, 0x044, 0x045, 0x045,
+  0x045, 0x045, 0x045, 0x045, 0x045, 0x045, 0x045, 0x045, 0x047, 0x047, 0x047, 0x047,
+  0x047, 0x047, 0x047, 0x047, 0x048, 0x048, 0x048, 0x048, 0x049, 0x049, 0x049, 0x049,
+  0x049, 0x049, 0x049, 0x049, 0x049, 0x049, 0x132, 0x132, 0x04A, 0x04A, 0x04B, 0x04B,
+  0x138, 0x04C, 0x04C, 0x04C, 0x04C, 0x04C, 0x04C, 0x04C, 0x04C, 0x04C, 0x04C, 0x04E,
+  0x04E, 0x04E, 0x04E, 0x04E, 0x04E, 0x149, 0x14A, 0x14A, 0x04F, 0x04F, 0x04F, 0x04F,
+  0x04F, 0x04F, 0x152, 0x152, 0x052, 0x052, 0x052, 0x052, 0x052, 0x052, 0x053, 0x053,
+  0x053, 0x053, 0x053, 0x053, 0x053, 0x053, 0x054, 0x054, 0x054, 0x054, 0x054, 0x054,
+  0x055, 0x055, 0x055, 0x055, 0x055, 0x055, 0x055, 0x055, 0x055, 0x055, 0x055, 0x055,
+  0x057, 0x057, 0x059, 0x059, 0x059, 0x05A, 0x05A, 0x05A, 0x05A, 0x05A, 0x05A, 0x053
+};
+
+/* Positions of the characters in the Enable alphabet: the capital form of the character if it is in the
+   alphabet (á -> Á), otherwise the form without diacritics (ö -> O), -1 if neither is. */
+static const int8_t slot_table[FOLD_TABLE_SIZE] = {
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, 26, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, 27, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1,  0,  1,  2,  3,  4,  5,  6,
+   7,  8,  9, 10, 11, 12, 13, 14, 15, 16, 17, 18,
+  19, 20, 21, 22, 23, 24, 25, -1, -1, -1, -1, -1,
+  -1,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10,
+  11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22,
+  23, 24, 25, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+   0, 28,  0,  0,  0,  0, -1,  2,  4, 31,  4,  4,
+   8, 33,  8,  8, -1, 13, 14, 35, 14, 14, 14, -1,
+  14, 20, 39, 20, 20, 41, -1, -1,  0, 28,  0,  0,
+   0,  0, -1,  2,  4, 31,  4,  4,  8, 33,  8,  8,
+  -1, 13, 14, 35, 14, 14, 14, -1, 14, 20, 39, 20,
+  20, 41, -1, 24,  0,  0,  0,  0,  0,  0,  2,  2,
+   2,  2,  2,  2, 29, 29, 30, 30,  3,  3,  4,  4,
+   4,  4,  4,  4,  4,  4, 32, 32,  6,  6,  6,  6,
+   6,  6,  6,  6,  7,  7,  7,  7,  8,  8,  8,  8,
+   8,  8,  8,  8,  8,  8, -1, -1,  9,  9, 10, 10,
+  -1, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 13,
+  13, 13, 13, 34, 34, -1, -1, -1, 14, 14, 14, 14,
+  14, 14, -1, -1, 17, 17, 17, 17, 36, 36, 18, 18,
+  18, 18, 18, 18, 37, 37, 19, 19, 38, 38, 19, 19,
+  20, 20, 20, 20, 20, 20, 40, 40, 20, 20, 20, 20,
+  22, 22, 24, 24, 24, 25, 25, 25, 25, 42, 42, 18
+};
+
+/* Function which decodes the character starting at s[*i] and moves *i behind it. A byte which does not
+   start a valid UTF-8 sequence is taken as a Latin-1 character. */
+uint32_t utf8_next(const char *s, size_t len, size_t *i)
+{
+  const unsigned char *p = (const unsigned char *)s + *i;
+  uint32_t c = 0, min = 0;
+  size_t n = 0; // length of the sequence, 0 if p[0] cannot start one
+
+  if (p[0] < 0x80){
+    (*i)++;
+    return p[0];
+  }
+  else if (p[0] >= 0xC2 && p[0] <= 0xDF){
+    c = p[0] & 0x1F;
+    n = 2;
+  }
+  else if (p[0] >= 0xE0 && p[0] <= 0xEF){
+    c = p[0] & 0x0F;
+    n = 3;
+    min = 0x800;
+  }
+  else if (p[0] >= 0xF0 && p[0] <= 0xF4){
+    c = p[0] & 0x07;
+    n = 4;
+    min = 0x10000;
+  }
+
+  if (n > len - *i)
+    n = 0;
+  for (size_t k = 1; k < n; k++){
+    if ((p[k] & 0xC0) != 0x80){
+      n = 0;
+      break;
+    }
+    c = (c << 6) | (p[k] & 0x3F);
+  }
+
+  // Overlong sequences and characters above U+10FFFF are not valid either.
+  if (n == 0 || c < min || c > 0x10FFFF){
+    (*i)++;
+    return p[0];
+  }
+  *i += n;
+  return c;
+}
+
+// Function which returns a character folded to a capital letter without diacritics.
+uint32_t utf8_fold(uint32_t c)
+{
+  return c < FOLD_TABLE_SIZE ? fold_table[c] : c;
+}
+
+// Function which returns the position of a character in the Enable alphabet or -1.
+int enable_slot(uint32_t c)
+{
+  return c < FOLD_TABLE_SIZE ? slot_table[c] : -1;
+}
@@ -0,0 +1,35 @@
+/*
+ * File:          utf8.h
+ * Date:          05. 11. 2017
+ * Author:        Dominik Vecera, xvecer23@stud.fit.vutbr.cz
+ * Project:       Working with text
+ * Description:   Decoding of UTF-8 and folding of characters for the comparison with the input prefix.
+ *                Characters are compared without their case and diacritics (Plzeň matches PLZEN), the
+ *                folding is looked up in precomputed tables covering Latin-1 and Latin Extended-A.
+ *                The Enable output uses the alphabet A-Z, space, '-' and the Czech capital letters
+ *                with diacritics, a set of its characters is kept as a 64-bit mask.
+ */
+
+#ifndef UTF8_H
+#define UTF8_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define FOLD_TABLE_SIZE 0x180 // characters with a folding in the tables, the others are kept as they are
+#define ENABLE_SLOTS 43       // number of characters of the Enable alphabet
+
+// Texts of the characters of the Enable alphabet in the order of the output.
+extern const char *const enable_chars[ENABLE_SLOTS];
+
+/* Function which decodes the character starting at s[*i] and moves *i behind it. A byte which does not
+   start a valid UTF-8 sequence is taken as a Latin-1 character. */
+uint32_t utf8_next(const char *s, size_t len, size_t *i);
+
+// Function which returns a character folded to a capital letter without diacritics.
+uint32_t utf8_fold(uint32_t c);
+
+// Function which returns the position of a character in the Enable alphabet or -1.
+int enable_slot(uint32_t c);
+
+#endif
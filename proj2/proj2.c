@@ -7,31 +7,205 @@
 /*                                                                  */
 /********************************************************************/
 
-#include <stdio.h>
+#include <stdio.h>
 #include <stdlib.h>
-#include <string.h>
+#include <string.h>
 #include <math.h>
+#include <limits.h>
+#include <stdint.h>
+#include <time.h>
+#include <float.h>
+#include <pthread.h>
+#include <quadmath.h>
+#include "tan_coefs.h" // generated by taygen (make)
+
+#if defined(__AVX__) || defined(__SSE2__) || defined(__x86_64__)
+#include <immintrin.h>
+#endif
 
 #define MAX_ITER 10 // number of necessary iterations for accurately computing cfrac_tan
+#define MAX_ITER_LONG 12 // iterations of cfrac_tan for the full precision of long double at the angle 1.4
+#define MAX_ITER_QUAD 18 // and of __float128
 #define TAN_MIN_ITER 0
-#define TAN_MAX_ITER 14 // number of iterations when comparing tan should be between 0 and 14
+#define TAN_MAX_ITER (TAN_TERMS + 1) // number of iterations when comparing tan should be between 0 and TAN_TERMS + 1
+#define TAN_BUCKETS 28        // angles (0 ; 1.4> are split into buckets of the iteration table
+#define TAN_BUCKET_WIDTH 0.05
+#define TAN_DECADES 15        // errors from 1e-1 to 1e-15 in the iteration table
+#define TAN_TABLE_MAX_ITER 20 // the most iterations searched when the table is generated
+#define TAN_TABLE_SAMPLES 1000 // angles compared with tan() in every bucket when the table is generated
+#define TAN_STEP 64         // the table of tan of the full-range tan has breakpoints i / TAN_STEP
+#define SWEEP_ANGLES 100000   // implicit number of angles of the sweep of the methods
+#define SWEEP_MAX_ITER 13     // the methods are swept with 1 to SWEEP_MAX_ITER iterations (members)
+#define SWEEP_TAYLOR_MAX_ITER ((TAN_TERMS < SWEEP_MAX_ITER) ? TAN_TERMS : SWEEP_MAX_ITER) // Taylor series has TAN_TERMS members
+#define BATCH_SIZE 4096 // number of angles read, computed and written at once in the batch mode
+#define BATCH_VECTORS 4 // number of independent vectors computed together, so the divisions overlap
+#define SURVEY_BLOCK (1 << 23)  // bytes of the input read at once in the survey mode
+#define SURVEY_CHUNK 4096       // records computed together by one thread in the survey mode
+#define SURVEY_MAX_THREADS 64   // the most threads of the survey mode, also chunks computed between two reads
+#define SURVEY_LINE 48          // space for one line of the output of the survey mode
+
+/* Vector loops of the batch mode for vectors V of L doubles with the intrinsics P##..._pd (_mm_ or _mm256_),
+   defined as cfrac_tan_NAME() and taylor_tan_NAME() with the attributes ATTR. The angles are computed in the
+   lanes of BATCH_VECTORS vectors at once, so the divisions overlap, with the same results as cfrac_tan() and
+   taylor_tan(). They return the number of angles done, the rest is left to the scalar functions. */
+#define DEFINE_TAN_VECTORS(NAME, ATTR, V, L, P) \
+ATTR static size_t cfrac_tan_##NAME(const double *x, double *y, size_t count, unsigned int n) \
+{ \
+  size_t i = 0; \
+  for (; i + L * BATCH_VECTORS <= count; i += L * BATCH_VECTORS){ \
+    V vx[BATCH_VECTORS], cf[BATCH_VECTORS]; \
+    double a = n * 2 + 1; \
+    for (int v = 0; v < BATCH_VECTORS; v++){ \
+      vx[v] = P##loadu_pd(x + i + v * L); \
+      cf[v] = P##set1_pd(INFINITY); \
+    } \
+    for (unsigned int k = n+1; k > 0; k--){ \
+      V va = P##set1_pd(a); \
+      for (int v = 0; v < BATCH_VECTORS; v++) \
+        cf[v] = P##div_pd(P##set1_pd(1.0), P##sub_pd(P##div_pd(va, vx[v]), cf[v])); \
+      a -= 2; \
+    } \
+    for (int v = 0; v < BATCH_VECTORS; v++) \
+      P##storeu_pd(y + i + v * L, cf[v]); \
+  } \
+  return i; \
+} \
+\
+ATTR static size_t taylor_tan_##NAME(const double *x, double *y, size_t count, unsigned int n) \
+{ \
+  size_t i = 0; \
+  for (; i + L * BATCH_VECTORS <= count; i += L * BATCH_VECTORS){ \
+    V vx[BATCH_VECTORS], x2[BATCH_VECTORS], result[BATCH_VECTORS]; \
+    for (int v = 0; v < BATCH_VECTORS; v++){ \
+      vx[v] = P##loadu_pd(x + i + v * L); \
+      x2[v] = P##mul_pd(vx[v], vx[v]); \
+      result[v] = P##set1_pd(tan_coefs[n-1]); \
+    } \
+    for (unsigned int k = n-1; k > 0; k--){ \
+      V c = P##set1_pd(tan_coefs[k-1]); \
+      for (int v = 0; v < BATCH_VECTORS; v++) \
+        result[v] = P##add_pd(P##mul_pd(result[v], x2[v]), c); \
+    } \
+    for (int v = 0; v < BATCH_VECTORS; v++) \
+      P##storeu_pd(y + i + v * L, P##mul_pd(result[v], vx[v])); \
+  } \
+  return i; \
+}
+
+/* The batch mode uses 4 lanes if it is built for AVX (make AVX=1), otherwise the 2 lanes of SSE2. On x86-64
+   the loops are also built for AVX2 with 4 lanes and they are chosen when the processor has it. */
+#if defined(__AVX__)
+#define VEC_LANES 4
+#elif defined(__SSE2__)
+#define VEC_LANES 2
+#endif
+#if defined(__x86_64__) && !defined(__AVX__)
+#define TAN_AVX2
+#endif
+
+// pi/2 in parts for the Cody-Waite reduction, the first three have 33 bits, so k * part is exact for k < 2^20.
+#define PIO2_1 1.57079632673412561417e+00
+#define PIO2_2 6.07710050630396597660e-11
+#define PIO2_3 2.02226624871116645580e-21
+#define PIO2_3T 8.47842766036889956997e-32
+#define INV_PIO2 6.36619772367581382433e-01
+#define PIO2_HI 0x1.921fb54442d18p+0 // pi/2 = PIO2_HI + PIO2_LO
+#define PIO2_LO 0x1.1a62633145c07p-54
+#define CODY_WAITE_MAX 0x1.921fb54442d18p+20 // larger angles are reduced by Payne-Hanek
+
+__extension__ typedef unsigned __int128 uint128;
+__extension__ typedef __int128 int128;
+__extension__ typedef __float128 quad;
+
+// Precision of the computation of tan, selected by --precision.
+typedef enum {
+  PREC_DOUBLE,
+  PREC_LONG,   // long double, 64 bits of the mantissa on x86
+  PREC_QUAD,   // __float128 from libquadmath, 113 bits of the mantissa
+  PREC_ALL     // all of them one after another (only for --tan)
+} precision;
 
-// Function which counts tan of an angle in radians using Taylor series.
+static const char *precision_names[] = {"double", "long", "quad", "all"};
+
+// Bits of 2/pi after the binary point, 64 in a word, for the Payne-Hanek reduction of angles up to DBL_MAX.
+static const uint64_t two_over_pi[] = {
+  0xA2F9836E4E441529ULL, 0xFC2757D1F534DDC0ULL, 0xDB6295993C439041ULL,
+  0xFE5163ABDEBBC561ULL, 0xB7246E3A424DD2E0ULL, 0x06492EEA09D1921CULL,
+  0xFE1DEB1CB129A73EULL, 0xE88235F52EBB4484ULL, 0xE99C7026B45F7E41ULL,
+  0x3991D639835339F4ULL, 0x9C845F8BBDF9283BULL, 0x1FF897FFDE05980FULL,
+  0xEF2F118B5A0A6D1FULL, 0x6D367ECF27CB09B7ULL, 0x4F463F669E5FEA2DULL,
+  0x7527BAC7EBE5F17BULL, 0x3D0739F78A5292EAULL, 0x6BFB5FB11F8D5D08ULL,
+  0x56033046FC7B6BABULL, 0xF0CFBC209AF4361DULL,
+};
+
+// tan(i / TAN_STEP) for 0 <= i / TAN_STEP <= pi/4 as the sum of two doubles (computed with 80 digits).
+static const double tan_breakpoints[][2] = {
+  {0x0.0p+0, 0x0.0p+0},
+  {0x1.0005557778549p-6, -0x1.4792827ea2e3ep-60},
+  {0x1.00155777aec08p-5, 0x1.5f48b25fa0262p-59},
+  {0x1.80481036e4452p-5, 0x1.3d85e10c65fcep-60},
+  {0x1.005577854df01p-4, -0x1.f35b10671bea1p-58},
+  {0x1.40a71317603a9p-4, 0x1.e341cf23dfe5cp-58},
+  {0x1.8121042019d39p-4, 0x1.e53de54163d36p-58},
+  {0x1.c1cb884ae7ce3p-4, -0x1.91f3cfab70c67p-60},
+  {0x1.01577af1511a5p-3, -0x1.fba60a478d2b0p-59},
+  {0x1.21e9e01751d9cp-3, -0x1.8f2e9b85cdb48p-60},
+  {0x1.42a13df7bb968p-3, -0x1.981948de81ac0p-57},
+  {0x1.6381f20021d08p-3, -0x1.9360ee39e7d86p-58},
+  {0x1.84906f1132568p-3, 0x1.20efcd2f809c3p-60},
+  {0x1.a5d13ffc776f5p-3, 0x1.b89182a3a38d7p-57},
+  {0x1.c7490a1d1e12dp-3, 0x1.d2fc0e48d3694p-58},
+  {0x1.e8fc900f0376bp-3, -0x1.b971a98dc7fb0p-57},
+  {0x1.05785a43c4c56p-2, -0x1.9c6bfe7769a3dp-58},
+  {0x1.16953ea9fb257p-2, 0x1.06b03f377d8f0p-59},
+  {0x1.27d78b40b7704p-2, 0x1.f391de0df335dp-56},
+  {0x1.3941ead97b329p-2, -0x1.736dee67c7385p-57},
+  {0x1.4ad71ed51ce39p-2, -0x1.b8c42b22fff4bp-56},
+  {0x1.5c9a01043014bp-2, -0x1.8a3aeeb99c243p-57},
+  {0x1.6e8d85a6493e1p-2, -0x1.80e8ea578b238p-56},
+  {0x1.80b4bd8b3bdd9p-2, 0x1.5a80279094351p-59},
+  {0x1.9312d859bf8b0p-2, -0x1.de9ddeb7d4180p-57},
+  {0x1.a5ab26ff403edp-2, -0x1.522f5c7d91fa7p-59},
+  {0x1.b8811e4d009c3p-2, -0x1.2f8192327ea6bp-58},
+  {0x1.cb9859c724099p-2, -0x1.923f8a8057bf7p-57},
+  {0x1.def49eaab37a1p-2, 0x1.1e48c7a265428p-56},
+  {0x1.f299df303cebbp-2, -0x1.925b4a577d0aap-58},
+  {0x1.03461f08a685dp-1, -0x1.71d22a449a2eap-55},
+  {0x1.0d68092bdb64ep-1, -0x1.9115b88532a0ap-55},
+  {0x1.17b4f5bf3474ap-1, 0x1.0c5e59201e209p-55},
+  {0x1.222f4af63cacdp-1, 0x1.5ffe451c2abd6p-56},
+  {0x1.2cd98fea0ab88p-1, 0x1.bf004c33955cbp-57},
+  {0x1.37b66f4018e8ep-1, -0x1.1899339e50c0ep-56},
+  {0x1.42c8ba0e9537ap-1, -0x1.1817d3747956ap-56},
+  {0x1.4e136b0504b5fp-1, -0x1.cfa9c233bbb31p-56},
+  {0x1.5999a9e0f5129p-1, -0x1.ebf504ca1c5d4p-56},
+  {0x1.655ecf3776ef1p-1, -0x1.a80657cbfeeb6p-55},
+  {0x1.7166689d41ef0p-1, -0x1.f44ffce65ed2bp-55},
+  {0x1.7db43d38b62cap-1, 0x1.489d3c731da14p-55},
+  {0x1.8a4c52ca75a77p-1, 0x1.4d66e6bea4d61p-55},
+  {0x1.9732f33b14612p-1, 0x1.c2d4507fd437ap-57},
+  {0x1.a46cb2be6a0b2p-1, -0x1.29a64ecb1df2ep-56},
+  {0x1.b1fe769f7154ep-1, 0x1.32aa55fd9947dp-56},
+  {0x1.bfed7cca66b49p-1, 0x1.8d237cd4d9245p-55},
+  {0x1.ce3f642e15af6p-1, -0x1.98cfacf28c6b2p-55},
+  {0x1.dcfa36110eeecp-1, -0x1.f3cf665127fd2p-57},
+  {0x1.ec24707bf6687p-1, 0x1.8cb6d1fadd1dap-55},
+  {0x1.fbc511df5917fp-1, 0x1.4e6ef3dde2f07p-55},
+  {0x1.05f1d310d7282p+0, -0x1.a71bbb015eecdp-54},
+};
+
+/* Function which counts tan of an angle in radians using the first n members of Taylor series in Horner's form,
+   x * P(x^2) with the coefficients from tan_coefs.h. n must not exceed TAN_TERMS, there are no more coefficients. */
 double taylor_tan(double x, unsigned int n)
 {
-  // num - numerators, denom - denominators, both the first 13 of Taylor series for tan(x)
-  long long num[13] = {1, 1, 2, 17, 62, 1382, 21844, 929569, 6404582, 443861162,
-    18888466084, 113927491862, 58870668456604};
-  long long denom[13] = {1, 3, 15, 315, 2835, 155925, 6081075, 638512875, 10854718875,
-    1856156927625, 194896477400625, 49308808782358125, 3698160658676859375};
-  double result = x; // for storing the result
-  double xpow = x; // for multiplying by x^2 during each iteration
-  for (unsigned int i = 1; i < n; i++){
-    xpow *= (x*x);
-    result += ((num[i] * xpow) / denom[i]);
-  }
+  if (n == 0)
+    return x;
 
-  return result;
+  double x2 = x * x;
+  double result = tan_coefs[n-1];
+  for (unsigned int i = n-1; i > 0; i--)
+    result = result * x2 + tan_coefs[i-1];
+  return result * x;
 }
 
 // Function which counts tan of an angle in radians using continued fraction computation.
@@ -49,6 +223,730 @@ double cfrac_tan(double x, unsigned int n)
   return cf;
 }
 
+static long double tan_coefs_long[TAN_TERMS];
+static quad tan_coefs_quad[TAN_TERMS];
+
+// Function which sums the parts of the coefficients of Taylor series from tan_coefs.h for the extended precisions.
+void init_extended_coefs(void)
+{
+  for (int i = 0; i < TAN_TERMS; i++){
+    tan_coefs_long[i] = ((long double)tan_coefs_ext[i][0] + tan_coefs_ext[i][1]) + tan_coefs_ext[i][2];
+    tan_coefs_quad[i] = ((quad)tan_coefs_ext[i][0] + tan_coefs_ext[i][1]) + tan_coefs_ext[i][2];
+  }
+}
+
+// Function which counts tan of an angle using Taylor series in long double, as taylor_tan() does.
+long double taylor_tanl(long double x, unsigned int n)
+{
+  if (n == 0)
+    return x;
+
+  long double x2 = x * x;
+  long double result = tan_coefs_long[n-1];
+  for (unsigned int i = n-1; i > 0; i--)
+    result = result * x2 + tan_coefs_long[i-1];
+  return result * x;
+}
+
+/* Function which counts tan of an angle using continued fractions in long double, as cfrac_tan() does.
+   The first step of cfrac_tan() only turns its infinite start into -0, so this one starts from 0 with the same
+   results. An infinite operand makes every x87 division slow. */
+long double cfrac_tanl(long double x, unsigned int n)
+{
+  long double cf = 0;
+  long double a = n * 2 - 1;
+
+  for (unsigned int k = n; k > 0; k--){
+    cf = 1.0L / ((a/x) - cf);
+    a -= 2;
+  }
+  return cf;
+}
+
+// Function which counts tan of an angle using Taylor series in __float128, as taylor_tan() does.
+quad taylor_tanq(quad x, unsigned int n)
+{
+  if (n == 0)
+    return x;
+
+  quad x2 = x * x;
+  quad result = tan_coefs_quad[n-1];
+  for (unsigned int i = n-1; i > 0; i--)
+    result = result * x2 + tan_coefs_quad[i-1];
+  return result * x;
+}
+
+// Function which counts tan of an angle using continued fractions in __float128, starting from 0 as cfrac_tanl() does.
+quad cfrac_tanq(quad x, unsigned int n)
+{
+  quad cf = 0;
+  quad a = n * 2 - 1;
+
+  for (unsigned int k = n; k > 0; k--){
+    cf = 1 / ((a/x) - cf);
+    a -= 2;
+  }
+  return cf;
+}
+
+/* Minimal iterations of cfrac_tan() for the absolute [0] and relative [1] error 1e-(d+1) of tan
+   of the angles in ((b * TAN_BUCKET_WIDTH) ; (b+1) * TAN_BUCKET_WIDTH>, 0 if it cannot be reached.
+   Generated by proj2 --tan-table. */
+static const unsigned char tan_iter_table[2][TAN_BUCKETS][TAN_DECADES] = {
+  {
+    {1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4},
+    {1, 1, 1, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 5, 5},
+    {1, 1, 2, 2, 2, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5},
+    {1, 1, 2, 2, 2, 3, 3, 3, 4, 4, 4, 5, 5, 5, 6},
+    {1, 1, 2, 2, 3, 3, 3, 4, 4, 4, 5, 5, 5, 6, 6},
+    {1, 1, 2, 2, 3, 3, 4, 4, 4, 5, 5, 5, 6, 6, 6},
+    {1, 2, 2, 3, 3, 3, 4, 4, 4, 5, 5, 6, 6, 6, 6},
+    {1, 2, 2, 3, 3, 4, 4, 4, 5, 5, 5, 6, 6, 6, 7},
+    {1, 2, 2, 3, 3, 4, 4, 4, 5, 5, 6, 6, 6, 7, 7},
+    {1, 2, 2, 3, 3, 4, 4, 5, 5, 5, 6, 6, 7, 7, 7},
+    {1, 2, 3, 3, 4, 4, 4, 5, 5, 6, 6, 6, 7, 7, 7},
+    {1, 2, 3, 3, 4, 4, 5, 5, 5, 6, 6, 7, 7, 7, 8},
+    {2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 6, 7, 7, 7, 8},
+    {2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 7, 8, 8},
+    {2, 2, 3, 4, 4, 5, 5, 5, 6, 6, 7, 7, 7, 8, 8},
+    {2, 3, 3, 4, 4, 5, 5, 6, 6, 6, 7, 7, 8, 8, 8},
+    {2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 7, 8, 8, 9},
+    {2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 8, 9},
+    {2, 3, 4, 4, 5, 5, 6, 6, 7, 7, 7, 8, 8, 9, 9},
+    {2, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 8, 9, 9},
+    {2, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 9},
+    {3, 3, 4, 5, 5, 6, 6, 7, 7, 7, 8, 8, 9, 9, 10},
+    {3, 3, 4, 5, 5, 6, 6, 7, 7, 8, 8, 8, 9, 9, 10},
+    {3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10},
+    {3, 4, 4, 5, 6, 6, 7, 7, 7, 8, 8, 9, 9, 10, 0},
+    {3, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 9, 10, 0},
+    {3, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 0},
+    {4, 4, 5, 6, 6, 7, 7, 8, 8, 9, 9, 9, 10, 10, 0},
+  },
+  {
+    {1, 1, 1, 2, 2, 2, 3, 3, 3, 3, 3, 4, 4, 4, 4},
+    {1, 1, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 5, 5, 5},
+    {1, 1, 2, 2, 3, 3, 3, 3, 4, 4, 4, 5, 5, 5, 5},
+    {1, 2, 2, 2, 3, 3, 3, 4, 4, 4, 5, 5, 5, 6, 6},
+    {1, 2, 2, 2, 3, 3, 4, 4, 4, 5, 5, 5, 6, 6, 6},
+    {1, 2, 2, 3, 3, 3, 4, 4, 4, 5, 5, 5, 6, 6, 6},
+    {1, 2, 2, 3, 3, 4, 4, 4, 5, 5, 5, 6, 6, 6, 7},
+    {1, 2, 2, 3, 3, 4, 4, 4, 5, 5, 6, 6, 6, 7, 7},
+    {1, 2, 2, 3, 3, 4, 4, 5, 5, 5, 6, 6, 6, 7, 7},
+    {1, 2, 3, 3, 4, 4, 4, 5, 5, 6, 6, 6, 7, 7, 7},
+    {2, 2, 3, 3, 4, 4, 5, 5, 5, 6, 6, 6, 7, 7, 8},
+    {2, 2, 3, 3, 4, 4, 5, 5, 5, 6, 6, 7, 7, 7, 8},
+    {2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 6, 7, 7, 8, 8},
+    {2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 7, 8, 8},
+    {2, 2, 3, 4, 4, 5, 5, 5, 6, 6, 7, 7, 7, 8, 8},
+    {2, 3, 3, 4, 4, 5, 5, 6, 6, 6, 7, 7, 8, 8, 8},
+    {2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 7, 8, 8, 9},
+    {2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 8, 9},
+    {2, 3, 3, 4, 5, 5, 6, 6, 6, 7, 7, 8, 8, 9, 9},
+    {2, 3, 4, 4, 5, 5, 6, 6, 7, 7, 7, 8, 8, 9, 9},
+    {2, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 8, 9, 9},
+    {2, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 9},
+    {2, 3, 4, 4, 5, 6, 6, 7, 7, 7, 8, 8, 9, 9, 10},
+    {3, 3, 4, 5, 5, 6, 6, 7, 7, 8, 8, 8, 9, 9, 10},
+    {3, 3, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 9, 10},
+    {3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10},
+    {3, 4, 4, 5, 6, 6, 7, 7, 8, 8, 8, 9, 9, 10, 11},
+    {3, 4, 4, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11},
+  },
+};
+
+// Required error of tan for the measurement, err == 0 means MAX_ITER (MAX_ITER_LONG, MAX_ITER_QUAD) iterations.
+typedef struct {
+  double err;
+  int rel;        // the error is relative to tan of the angle, otherwise absolute
+  precision prec; // precision of the computation
+} tan_error;
+
+/* Function which returns the minimal number of iterations of cfrac_tan() for which the absolute
+   (or relative, if rel is set) error is at most err, or 0 if the error cannot be reached for the angle.
+   The error is rounded down to a power of ten and the iterations are read from tan_iter_table. */
+unsigned int cfrac_iterations(double angle, double err, int rel)
+{
+  double a = fabs(angle);
+
+  if (!(err > 0) || a > TAN_BUCKETS * TAN_BUCKET_WIDTH)
+    return 0;
+  int bucket = (a > 0) ? (int)ceil(a / TAN_BUCKET_WIDTH) - 1 : 0;
+  int decade = (err >= 0.1) ? 0 : (int)ceil(-log10(err) - 1e-9) - 1;
+  if (bucket >= TAN_BUCKETS)
+    bucket = TAN_BUCKETS - 1;
+  if (decade >= TAN_DECADES)
+    return 0;
+  return tan_iter_table[rel != 0][bucket][decade];
+}
+
+// Function which returns the number of iterations of cfrac_tan for the measurement with the required error.
+unsigned int measure_iterations(double angle, const tan_error *e)
+{
+  if (e->err > 0)
+    return cfrac_iterations(angle, e->err, e->rel);
+  return (e->prec == PREC_QUAD) ? MAX_ITER_QUAD : (e->prec == PREC_LONG) ? MAX_ITER_LONG : MAX_ITER;
+}
+
+/* Function which prints the distance measured from the height with the angle_a (and the height of the object
+   with the angle_b, if it is not NULL), computed in the precision of the run. */
+void print_measurement(double height, double angle_a, const double *angle_b, const tan_error *e)
+{
+  unsigned int n_a = measure_iterations(angle_a, e);
+  unsigned int n_b = angle_b ? measure_iterations(*angle_b, e) : 0;
+
+  if (e->prec == PREC_QUAD){
+    char buf[64];
+    quad d = height / cfrac_tanq(angle_a, n_a);
+    quadmath_snprintf(buf, sizeof(buf), "%.10Qe", d);
+    printf("%s\n", buf);
+    if (angle_b){
+      quadmath_snprintf(buf, sizeof(buf), "%.10Qe", height + cfrac_tanq(*angle_b, n_b) * d);
+      printf("%s\n", buf);
+    }
+  }
+  else if (e->prec == PREC_LONG){
+    long double d = height / cfrac_tanl(angle_a, n_a);
+    printf("%.10Le\n", d);
+    if (angle_b)
+      printf("%.10Le\n", height + cfrac_tanl(*angle_b, n_b) * d);
+  }
+  else {
+    double d = height / cfrac_tan(angle_a, n_a);
+    printf("%.10e\n", d);
+    if (angle_b)
+      printf("%.10e\n", height + cfrac_tan(*angle_b, n_b) * d);
+  }
+}
+
+/* Function which prints tan_iter_table for the current cfrac_tan(): in every bucket, the errors of
+   TAN_TABLE_SAMPLES angles up to its end are compared with tan() from math.h, as count_tan() does. */
+void print_tan_table(void)
+{
+  printf("/* Minimal iterations of cfrac_tan() for the absolute [0] and relative [1] error 1e-(d+1) of tan\n"
+         "   of the angles in ((b * TAN_BUCKET_WIDTH) ; (b+1) * TAN_BUCKET_WIDTH>, 0 if it cannot be reached.\n"
+         "   Generated by proj2 --tan-table. */\n"
+         "static const unsigned char tan_iter_table[2][TAN_BUCKETS][TAN_DECADES] = {\n");
+  for (int rel = 0; rel < 2; rel++){
+    printf("  {\n");
+    for (int b = 0; b < TAN_BUCKETS; b++){
+      double worst[TAN_TABLE_MAX_ITER + 1] = {0};
+
+      for (int i = 1; i <= TAN_TABLE_SAMPLES; i++){
+        double x = (b + (double)i / TAN_TABLE_SAMPLES) * TAN_BUCKET_WIDTH;
+        double M = tan(x);
+        for (unsigned int n = 1; n <= TAN_TABLE_MAX_ITER; n++){
+          double CE = fabs(cfrac_tan(x, n) - M) / (rel ? fabs(M) : 1.0);
+          if (CE > worst[n])
+            worst[n] = CE;
+        }
+      }
+      printf("    {");
+      for (int d = 0; d < TAN_DECADES; d++){
+        unsigned int n = 1;
+        while (n <= TAN_TABLE_MAX_ITER && worst[n] > pow(10, -(d + 1)))
+          n++;
+        printf("%s%u", d ? ", " : "", (n <= TAN_TABLE_MAX_ITER) ? n : 0);
+      }
+      printf("},\n");
+    }
+    printf("  },\n");
+  }
+  printf("};\n");
+}
+
+// Function which returns the bits pos+1 .. pos+64 after the binary point of 2/pi (pos >= -64).
+uint64_t two_over_pi_bits(int pos)
+{
+  int i = (pos + 64) / 64 - 1;
+  int shift = pos - 64 * i;
+  uint64_t high = (i >= 0) ? two_over_pi[i] : 0;
+
+  return shift ? (high << shift) | (two_over_pi[i+1] >> (64 - shift)) : high;
+}
+
+/* Function which reduces an angle |x| < CODY_WAITE_MAX to r = x - k * pi/2, |r| <= pi/4 (Cody-Waite).
+   Returns the high part of r, its low part is stored into *lo and k into *k. */
+double reduce_medium(double x, double *lo, int *k)
+{
+  double fk = (x * INV_PIO2 + 0x1.8p52) - 0x1.8p52; // rounded to the nearest integer, |x * 2/pi| < 2^51
+  double r = x - fk * PIO2_1; // exact, both k * PIO2_1 and the difference
+
+  // r - k * PIO2_2 - k * PIO2_3 as a sum of two doubles, the rounding errors are kept in the low part.
+  double t = fk * PIO2_2;
+  double hi = r - t;
+  double v = hi - r;
+  double err = (r - (hi - v)) - (t + v);
+  t = fk * PIO2_3;
+  double hi2 = hi - t;
+  v = hi2 - hi;
+  err += (hi - (hi2 - v)) - (t + v);
+  err -= fk * PIO2_3T;
+
+  *k = (int)fk;
+  double y = hi2 + err;
+  *lo = err - (y - hi2);
+  return y;
+}
+
+/* Function which reduces any finite angle to r = x - k * pi/2, |r| <= pi/4 (Payne-Hanek). Only the bits of 2/pi
+   which matter for k mod 8 and the fraction of x * 2/pi are multiplied by the mantissa of x, in 128-bit integers. */
+double reduce_large(double x, double *lo, int *k)
+{
+  int e;
+  uint64_t m = (uint64_t)ldexp(frexp(fabs(x), &e), 53); // |x| = m * 2^(e-53)
+  int pos = e - 56; // bits of 2/pi up to pos give multiples of 8, the window has the next 192 bits
+  uint128 p0 = (uint128)m * two_over_pi_bits(pos);
+  uint128 p1 = (uint128)m * two_over_pi_bits(pos + 64);
+  uint128 p2 = (uint128)m * two_over_pi_bits(pos + 128);
+
+  // x * 2/pi = (p0 * 2^128 + p1 * 2^64 + p2) / 2^189, its integer part mod 8 and 128 bits of the fraction.
+  uint128 mid = p1 + (p2 >> 64);
+  uint128 high = p0 + (mid >> 64);
+  int q = (int)(high >> 61) & 7;
+  uint128 f = (high << 67) | ((uint128)(uint64_t)mid << 3) | ((uint64_t)p2 >> 61);
+  if (f >> 127) // the fraction is at least 1/2, the nearest integer is the next one
+    q++;
+
+  // r = fraction * pi/2, the fraction (from -1/2 to 1/2) as the sum of two doubles.
+  int128 sf = (int128)f;
+  uint128 a = (sf < 0) ? (uint128)-sf : (uint128)sf;
+  double fh = (double)a;
+  double fl = (double)(int128)(a - (uint128)fh);
+  fh = ldexp(fh, -128);
+  fl = ldexp(fl, -128);
+  double rh = fh * PIO2_HI;
+  double rl = fma(fh, PIO2_HI, -rh) + (fh * PIO2_LO + fl * PIO2_HI);
+  double y = rh + rl;
+  rl -= y - rh;
+
+  int negative = (sf < 0) != (x < 0);
+  *k = (x < 0) ? -q : q;
+  *lo = negative ? -rl : rl;
+  return negative ? -y : y;
+}
+
+/* Function which counts tan(r) (or -1/tan(r) if odd is set) for |r| <= pi/4, r = hi + lo. The breakpoint b nearest
+   to r is taken from the table (t = tan(b)) and p = tan(r - b) by a short polynomial, then
+   tan(r) = (t + p) / (1 - t * p) = t + p + t * p * (t + p) / (1 - t * p). The sum t + (r - b) is exact, so the
+   rounding errors are only in the small rest. */
+double tan_kernel(double hi, double lo, int odd)
+{
+  int negative = hi < 0;
+
+  if (negative){
+    hi = -hi;
+    lo = -lo;
+  }
+  int i = (int)(hi * TAN_STEP + 0.5);
+  double d = hi - (double)i / TAN_STEP; // exact, |d| <= 1/(2 * TAN_STEP)
+  double d2 = d * d;
+  double rest = lo + d * d2 * (1.0 / 3 + d2 * (2.0 / 15 + d2 * (17.0 / 315))); // p = d + rest
+  double p = d + rest;
+  double t = tan_breakpoints[i][0];
+  double y = t + d;
+  double v = y - t;
+  double c = ((t - (y - v)) + (d - v)) + rest + tan_breakpoints[i][1] + t * p * (t + p) / (1 - t * p);
+
+  t = y;
+  y = t + c;
+  if (odd){
+    double e = c - (y - t); // y + e is tan(r) more precisely than y
+    y = -1 / y + e / (y * y);
+  }
+  return negative ? -y : y;
+}
+
+/* Function which counts tan of any angle in radians: the angle is reduced to (-pi/4 ; pi/4> by Cody-Waite or,
+   for large angles, by Payne-Hanek and the result is computed from the table of breakpoints. */
+double full_tan(double x)
+{
+  double lo;
+  int k;
+
+  if (isnan(x) || isinf(x))
+    return x - x;
+  if (fabs(x) < 0x1p-27) // x^3 / 3 is less than half of the last bit of x
+    return x;
+  double hi = (fabs(x) < CODY_WAITE_MAX) ? reduce_medium(x, &lo, &k) : reduce_large(x, &lo, &k);
+  return tan_kernel(hi, lo, k & 1);
+}
+
+#if defined(__AVX__)
+DEFINE_TAN_VECTORS(vectors, , __m256d, 4, _mm256_)
+#elif defined(__SSE2__)
+DEFINE_TAN_VECTORS(vectors, , __m128d, 2, _mm_)
+#endif
+#ifdef TAN_AVX2
+DEFINE_TAN_VECTORS(avx2, __attribute__((target("avx2"))), __m256d, 4, _mm256_)
+#endif
+
+/* Function which counts tan of count angles using continued fractions, the angles are computed
+   in the lanes of vectors at once with the same results as cfrac_tan(). */
+void cfrac_tan_batch(const double *x, double *y, size_t count, unsigned int n)
+{
+  size_t i = 0;
+
+#ifdef TAN_AVX2
+  if (__builtin_cpu_supports("avx2"))
+    i = cfrac_tan_avx2(x, y, count, n);
+#endif
+#ifdef VEC_LANES
+  if (i == 0)
+    i = cfrac_tan_vectors(x, y, count, n);
+#endif
+  for (; i < count; i++)
+    y[i] = cfrac_tan(x[i], n);
+}
+
+// Function which counts tan of count angles using Taylor series in Horner's form, the same way as cfrac_tan_batch().
+void taylor_tan_batch(const double *x, double *y, size_t count, unsigned int n)
+{
+  size_t i = 0;
+
+#ifdef TAN_AVX2
+  if (__builtin_cpu_supports("avx2"))
+    i = taylor_tan_avx2(x, y, count, n);
+#endif
+#ifdef VEC_LANES
+  if (i == 0)
+    i = taylor_tan_vectors(x, y, count, n);
+#endif
+  for (; i < count; i++)
+    y[i] = taylor_tan(x[i], n);
+}
+
+// Function which counts tan of count angles of any size by full_tan(), n is not used.
+void full_tan_batch(const double *x, double *y, size_t count, unsigned int n)
+{
+  (void)n;
+  for (size_t i = 0; i < count; i++)
+    y[i] = full_tan(x[i]);
+}
+
+// Reader of the angles for the batch mode, text (numbers separated by white space) or raw doubles.
+typedef struct {
+  FILE *f;
+  int binary;
+  char buf[BATCH_SIZE * 8 + 1];
+  size_t start, end; // unread part of buf
+  int eof;
+  int error;         // the input could not be read or an angle is not a number
+} angle_reader;
+
+// Function which reads more text into the buffer of a reader, keeping the unread part.
+void fill_angles(angle_reader *r)
+{
+  memmove(r->buf, r->buf + r->start, r->end - r->start);
+  r->end -= r->start;
+  r->start = 0;
+
+  size_t n = fread(r->buf + r->end, 1, sizeof(r->buf) - 1 - r->end, r->f);
+  r->end += n;
+  r->buf[r->end] = '\0';
+  if (n == 0){
+    r->eof = 1;
+    r->error |= ferror(r->f);
+  }
+}
+
+// Function which reads up to max angles, returns their number (0 at the end of the input or on an error).
+size_t read_angles(angle_reader *r, double *x, size_t max)
+{
+  size_t count = 0;
+
+  if (r->binary){
+    // fread() stops only at the end of the input or on an error, a part of a double left there is an error.
+    size_t bytes = fread(x, 1, max * sizeof(double), r->f);
+    if (bytes % sizeof(double) != 0 || (bytes < max * sizeof(double) && ferror(r->f)))
+      r->error = 1;
+    return r->error ? 0 : bytes / sizeof(double);
+  }
+
+  while (count < max && !r->error){
+    while (r->start < r->end && strchr(" \t\r\n", r->buf[r->start]) != NULL)
+      r->start++;
+
+    // The number has to end by white space in the buffer, unless the input ends with it.
+    size_t end = r->start;
+    while (end < r->end && strchr(" \t\r\n", r->buf[end]) == NULL)
+      end++;
+    if (end == r->end && !r->eof){
+      if (r->start == 0 && r->end == sizeof(r->buf) - 1){
+        r->error = 1; // too long to be a number
+        break;
+      }
+      fill_angles(r);
+      continue;
+    }
+    if (r->start == end) // the end of the input
+      break;
+
+    char *endptr;
+    x[count++] = strtod(r->buf + r->start, &endptr);
+    if (endptr != r->buf + end)
+      r->error = 1;
+    r->start = end;
+  }
+  return r->error ? 0 : count;
+}
+
+// Function which writes count results as text or raw doubles.
+int write_results(const double *y, size_t count, int binary)
+{
+  if (binary)
+    return fwrite(y, sizeof(double), count, stdout) == count;
+  for (size_t i = 0; i < count; i++)
+    printf("%.16e\n", y[i]);
+  return !ferror(stdout);
+}
+
+/* Function which counts tan of all angles from a file (stdin if path is NULL) with n iterations
+   of continued fractions (method "cfrac"), n members of Taylor series (method "taylor") or by full_tan() ("full"). */
+int batch_tan(const char *method, unsigned int n, int binary, const char *path)
+{
+  static angle_reader r;
+  static double x[BATCH_SIZE], y[BATCH_SIZE];
+  static char out[1 << 20];
+  void (*tan_batch)(const double *, double *, size_t, unsigned int) =
+    (strcmp(method, "cfrac") == 0) ? cfrac_tan_batch :
+    (strcmp(method, "taylor") == 0) ? taylor_tan_batch : full_tan_batch;
+  size_t count;
+  int written = 1;
+
+  r.f = (path == NULL) ? stdin : fopen(path, binary ? "rb" : "r");
+  if (r.f == NULL){
+    fprintf(stderr, "The file %s could not be opened.\n", path);
+    return 0;
+  }
+  r.binary = binary;
+  setvbuf(stdout, out, _IOFBF, sizeof(out)); // the results are written in large blocks
+
+  while (written && (count = read_angles(&r, x, BATCH_SIZE)) > 0){
+    tan_batch(x, y, count, n);
+    written = write_results(y, count, binary);
+  }
+  if (r.f != stdin)
+    fclose(r.f);
+  if (fflush(stdout) != 0)
+    written = 0;
+
+  if (r.error && binary)
+    fprintf(stderr, "The angles could not be read, the input is not a whole number of doubles.\n");
+  else if (r.error)
+    fprintf(stderr, "The angles could not be read, an angle is not a number.\n");
+  else if (!written)
+    fprintf(stderr, "The results could not be written.\n");
+  return !r.error && written;
+}
+
+// Function which returns a pseudorandom number from [0 ; 1) for the sweep (xorshift64).
+double random_unit(void)
+{
+  static uint64_t state = 88172645463325252ULL;
+
+  state ^= state << 13;
+  state ^= state >> 7;
+  state ^= state << 17;
+  return (state >> 11) * 0x1p-53;
+}
+
+// Repeats the evaluation expr until it takes at least 2 ms, *ns is set to the time of one evaluation.
+#define TIME_TAN(ns, sink, expr) do { \
+    long repeat = 1; \
+    clock_t start, elapsed; \
+    do { \
+      repeat *= 2; \
+      start = clock(); \
+      for (long r = 0; r < repeat; r++) \
+        sink = (expr); \
+      elapsed = clock() - start; \
+    } while (elapsed < CLOCKS_PER_SEC / 500); \
+    *(ns) = (double)elapsed / CLOCKS_PER_SEC * 1e9 / repeat; \
+    (void)sink; \
+  } while (0)
+
+double tan_sweep(double x, unsigned int n)
+{
+  (void)n;
+  return tan(x);
+}
+
+double full_tan_sweep(double x, unsigned int n)
+{
+  (void)n;
+  return full_tan(x);
+}
+
+// A method of the sweep, it counts one angle at a time (scalar) or a whole array (batch).
+typedef struct {
+  const char *name;
+  double (*scalar)(double, unsigned int);
+  void (*batch)(const double *, double *, size_t, unsigned int);
+  unsigned int iterations; // the method is swept with 1 to this many iterations, if it is 0 n is not used
+  int any_angle;  // the method is also swept on the angles of any size
+} sweep_method;
+
+/* Speed and accuracy of a method with n iterations on a set of angles (latency is NAN for the batch methods),
+   pareto is set if no other row of the set is both faster and more accurate. */
+typedef struct {
+  const char *name;
+  const char *range;
+  unsigned int n;
+  double latency, ns, max_abs, mean_abs, max_ulp, mean_ulp;
+  int pareto;
+} sweep_row;
+
+// Function which counts tan of all angles by a method into y, returns the last result.
+double sweep_pass(const sweep_method *m, unsigned int n, const double *x, double *y, size_t count)
+{
+  if (m->batch != NULL)
+    m->batch(x, y, count, n);
+  else
+    for (size_t i = 0; i < count; i++)
+      y[i] = m->scalar(x[i], n);
+  return y[count - 1];
+}
+
+// Function which counts tan of all angles by a scalar method, every angle waits for the previous result.
+double sweep_chain(const sweep_method *m, unsigned int n, const double *x, size_t count)
+{
+  double y = 0;
+
+  for (size_t i = 0; i < count; i++)
+    y = m->scalar(x[i] + y * 0.0, n);
+  return y;
+}
+
+// Function which sets the errors of a row from the results y and tan of the angles in __float128.
+void sweep_errors(sweep_row *r, const double *y, const quad *ref, size_t count)
+{
+  double sum_abs = 0, sum_ulp = 0;
+
+  r->max_abs = r->max_ulp = 0;
+  for (size_t i = 0; i < count; i++){
+    double m = fabs((double)ref[i]);
+    double ulp = nextafter(m, INFINITY) - m;
+    double err = (double)fabsq(y[i] - ref[i]);
+    if (err > r->max_abs)
+      r->max_abs = err;
+    if (err / ulp > r->max_ulp)
+      r->max_ulp = err / ulp;
+    sum_abs += err;
+    sum_ulp += err / ulp;
+  }
+  r->mean_abs = sum_abs / count;
+  r->mean_ulp = sum_ulp / count;
+}
+
+// Function which marks the rows of a set of angles which no other row of it beats in both time and the largest ulp error.
+void sweep_pareto(sweep_row *rows, size_t count)
+{
+  for (size_t i = 0; i < count; i++){
+    rows[i].pareto = 1;
+    for (size_t j = 0; j < count && rows[i].pareto; j++)
+      if (rows[j].ns <= rows[i].ns && rows[j].max_ulp <= rows[i].max_ulp
+          && (rows[j].ns < rows[i].ns || rows[j].max_ulp < rows[i].max_ulp))
+        rows[i].pareto = 0;
+  }
+}
+
+void print_sweep_row(const sweep_row *r)
+{
+  char n[16] = "-", latency[16] = "-";
+
+  if (r->n > 0)
+    snprintf(n, sizeof(n), "%u", r->n);
+  if (!isnan(r->latency))
+    snprintf(latency, sizeof(latency), "%.2f", r->latency);
+  printf("%-13s %-12s %4s %10s %10.2f %12.3e %12.3e %12.3g %12.3g %s\n", r->name, r->range, n, latency, r->ns,
+         r->max_abs, r->mean_abs, r->max_ulp, r->mean_ulp, r->pareto ? "*" : "");
+}
+
+int compare_sweep_rows(const void *a, const void *b)
+{
+  const sweep_row *r = a, *s = b;
+  int range = strcmp(r->range, s->range);
+  return range ? range : (r->ns > s->ns) - (r->ns < s->ns);
+}
+
+/* Function which sweeps tan of count angles evenly spread over (0 ; 1.4> by every method with 1 to SWEEP_MAX_ITER
+   iterations (Taylor series with at most TAN_TERMS members), and of count random angles from 2^-30 to 2^60 of both signs by tan() and full_tan(). The latency
+   (every angle waits for the previous result) and the time of independent evaluations are in nanoseconds, the
+   largest and mean absolute and ulp errors are from tanq(). The rows of a set of angles which no other row beats
+   in both time and the largest ulp error (the Pareto front) are marked and printed again from the fastest one,
+   to choose the method and the iterations for a required accuracy. */
+int tan_sweep_bench(size_t count)
+{
+  static const sweep_method methods[] = {
+    {"tan", tan_sweep, NULL, 0, 1},
+    {"full", full_tan_sweep, NULL, 0, 1},
+    {"taylor", taylor_tan, NULL, SWEEP_TAYLOR_MAX_ITER, 0},
+    {"cfrac", cfrac_tan, NULL, SWEEP_MAX_ITER, 0},
+    {"taylor_batch", NULL, taylor_tan_batch, SWEEP_TAYLOR_MAX_ITER, 0},
+    {"cfrac_batch", NULL, cfrac_tan_batch, SWEEP_MAX_ITER, 0},
+  };
+  static const char *ranges[] = {"(0;1.4>", "+-2^(-30;60)"};
+  enum {METHODS = sizeof(methods) / sizeof(methods[0])};
+  sweep_row rows[METHODS * SWEEP_MAX_ITER + METHODS];
+  size_t nrows = 0, first[3] = {0};
+  double *x = calloc(count, sizeof(*x)), *y = calloc(count, sizeof(*y));
+  quad *ref = calloc(count, sizeof(*ref));
+
+  if (x == NULL || y == NULL || ref == NULL){
+    fprintf(stderr, "Not enough memory for %zu angles.\n", count);
+    free(x);
+    free(y);
+    free(ref);
+    return 0;
+  }
+
+  for (int set = 0; set < 2; set++){
+    for (size_t i = 0; i < count; i++){
+      x[i] = (set == 0) ? 1.4 * (i + 1) / count
+             : ldexp(0.5 + 0.5 * random_unit(), -30 + (int)(91 * random_unit())) * (random_unit() < 0.5 ? -1 : 1);
+      ref[i] = tanq(x[i]);
+    }
+
+    for (size_t k = 0; k < METHODS; k++){
+      if (set == 1 && !methods[k].any_angle)
+        continue;
+      for (unsigned int n = 1; n <= (methods[k].iterations ? methods[k].iterations : 1); n++){
+        volatile double sink;
+        sweep_row *r = &rows[nrows++];
+        r->name = methods[k].name;
+        r->range = ranges[set];
+        r->n = methods[k].iterations ? n : 0;
+        TIME_TAN(&r->ns, sink, sweep_pass(&methods[k], n, x, y, count));
+        r->ns /= count;
+        r->latency = NAN;
+        if (methods[k].scalar != NULL){
+          TIME_TAN(&r->latency, sink, sweep_chain(&methods[k], n, x, count));
+          r->latency /= count;
+        }
+        sweep_pass(&methods[k], n, x, y, count);
+        sweep_errors(r, y, ref, count);
+      }
+    }
+    first[set + 1] = nrows;
+    sweep_pareto(rows + first[set], nrows - first[set]);
+  }
+
+  printf("%-13s %-12s %4s %10s %10s %12s %12s %12s %12s %s\n", "method", "angles", "n", "latency_ns", "ns",
+         "max_abs", "mean_abs", "max_ulp", "mean_ulp", "pareto");
+  for (size_t i = 0; i < nrows; i++)
+    print_sweep_row(&rows[i]);
+  qsort(rows, nrows, sizeof(rows[0]), compare_sweep_rows);
+  printf("\nPareto front (%zu angles of each set), from the fastest one:\n", count);
+  for (size_t i = 0; i < nrows; i++)
+    if (rows[i].pareto)
+      print_sweep_row(&rows[i]);
+  free(x);
+  free(y);
+  free(ref);
+  return 1;
+}
+
 // Function which prints the manual for program usage.
 void print_help()
 {
@@ -56,29 +954,55 @@ void print_help()
   "How to use the program:\n\n"
   "Compare the accuracies of different methods of computing tan:\n"
   "-------------------------------------------------------------\n"
-  "--tan A N M\n"
+  "[--precision P] --tan A N M\n"
   "A = angle in radians\n"
-  "N, M - in which iterations the results are to be compared, 0 < N <= M < 14\n\n"
-  "Output: I M T TE C CE\n"
+  "N, M - in which iterations the results are to be compared, 0 < N <= M < %d\n"
+  "P = double (implicit), long (long double), quad (__float128) or all (a table for each of them)\n\n"
+  "Output: I M T TE C CE TT CT\n"
   "I  = iteration number\n"
-  "M  = result from Math.h library\n"
+  "M  = result from Math.h library (tan, tanl or tanq of libquadmath)\n"
   "T  = result computed with Taylor series\n"
   "TE = absolute error between Math.h and Taylor series computations\n"
   "C  = result computed with continued fractions\n"
-  "CE = absolute error between Math.h and continued fraction computations\n\n"
+  "CE = absolute error between Math.h and continued fraction computations\n"
+  "TT, CT = time of one computation with Taylor series and continued fractions in nanoseconds\n\n"
+  "Compute tan of many angles at once:\n"
+  "-----------------------------------\n"
+  "--batch METHOD N [-b] [FILE], --batch full [-b] [FILE]\n"
+  "METHOD = cfrac (continued fractions) or taylor (Taylor series)\n"
+  "N = number of iterations, 0 < N < %d\n"
+  "full = any angle, reduced to (-pi/4 ; pi/4> and computed from a table of tan\n"
+  "-b = the angles and the results are raw doubles instead of text\n"
+  "FILE = file with angles in radians, one per line (implicitly stdin)\n"
+  "Output: tan of every angle, in the same order\n\n"
+  "--tan-sweep [COUNT]\n"
+  "Compare the speed and accuracy of tan from math.h, full, taylor, cfrac and their batch forms with 1 to %d\n"
+  "iterations on COUNT angles spread over (0 ; 1.4> (implicitly 100000), and of tan and full on COUNT random\n"
+  "angles from 2^-30 to 2^60 of both signs. Output: the latency (every angle waits for the previous result)\n"
+  "and the time of one evaluation in nanoseconds, the largest and mean absolute and ulp errors from tanq;\n"
+  "the rows which no other row of their angles beats in both time and the largest ulp error are marked *\n"
+  "and listed again (make bench)\n\n"
   "Count length and height using continued fraction tan computation:\n"
   "-------------------------------------------------------------------\n"
-  "[-c X] -m A [B]\n"
+  "[-e E | -r E] [--precision P] [-c X] -m A [B]\n"
   "A, B = angles in radians (B - optional), both in interval (0 ; 1.4>\n"
-  "X = height of meter (optional, in interval (0 ; 100>, implicit value = 1.5 m)\n");
+  "X = height of meter (optional, in interval (0 ; 100>, implicit value = 1.5 m)\n"
+  "E = required absolute (-e) or relative (-r) error of tan (optional, implicitly 10 iterations are used),\n"
+  "    the fewest iterations reaching it are read from the table printed by --tan-table\n"
+  "P = double (implicit), long or quad, the precision of the computation (implicitly %d or %d iterations)\n\n"
+  "--survey T [FILE]\n"
+  "Count length and height of every record height,alpha[,beta] of a CSV file (implicitly stdin) with T threads,\n"
+  "0 < T <= %d, the height may be empty (1.5 m) and so may beta, a header line is allowed\n"
+  "Output: length,height of every record (height empty without beta), in the same order\n",
+  TAN_MAX_ITER, TAN_MAX_ITER, SWEEP_MAX_ITER, MAX_ITER_LONG, MAX_ITER_QUAD, SURVEY_MAX_THREADS);
 }
 
 // Function which converts a string to an integer number.
 int str_to_int(char *s)
 {
   char *endptr;
-  int num = strtol(s, &endptr, 0);
-  if (endptr[0] == '\0' && !isinf(num) && !isnan(num))
+  long num = strtol(s, &endptr, 0);
+  if (endptr[0] == '\0' && num >= INT_MIN && num <= INT_MAX)
     return num;
   else
     return 0;
@@ -100,6 +1024,10 @@ typedef enum {
     GENERAL_ERROR, // general error for when arguments are set the wrong way
     HELP,          // show help
     TAN,           // count tan
+    BATCH,         // count tan of many angles
+    SURVEY,        // measure distance and height of many records
+    TAN_TABLE,     // print the table of iterations for the required errors
+    TAN_SWEEP,     // compare the speed and accuracy of the methods with all iteration counts
     NO_ARGS,       // when no arguments were set
     DIST_A,        // measure distance - set are: angle alpha
     DIST_H_AB,     // measure distance and height - set are: angles alpha and beta
@@ -125,51 +1053,358 @@ int correct_height(double height)
     return 0;
 }
 
-// Function which iteratively counts tan of an angle with various methods.
-int count_tan(double tg, unsigned int n, unsigned int m)
+/* Function which writes x as printf("%.10e") does and returns the number of characters. The 11 digits are
+   rounded from x scaled by a power of ten in long double, printf is used only if the scaled number is too
+   close to a half to be rounded correctly (or out of the exact powers of ten, or not a finite number). */
+size_t format_e10(char *s, double x)
+{
+#if LDBL_MANT_DIG >= 64
+  static const long double pow10[] = {
+    1e0L, 1e1L, 1e2L, 1e3L, 1e4L, 1e5L, 1e6L, 1e7L, 1e8L, 1e9L, 1e10L, 1e11L, 1e12L, 1e13L,
+    1e14L, 1e15L, 1e16L, 1e17L, 1e18L, 1e19L, 1e20L, 1e21L, 1e22L, 1e23L, 1e24L, 1e25L, 1e26L, 1e27L,
+  }; // exact in long double, the product or the quotient is off by 2^-64 of it at most
+  double a = fabs(x);
+  int e10 = (a > 0 && a <= DBL_MAX) ? (int)floor(log10(a)) : INT_MIN;
+
+  for (int tries = 0; tries < 3 && e10 > -100 && e10 < 100; tries++){
+    int k = 10 - e10;
+    if (k > 27 || k < -27)
+      break;
+    long double m = (k >= 0) ? a * pow10[k] : a / pow10[-k];
+    if (m < 1e10L || m >= 1e11L){ // log10 was rounded to the next decade
+      e10 += (m < 1e10L) ? -1 : 1;
+      continue;
+    }
+    long double whole = floorl(m);
+    if (fabsl(m - whole - 0.5L) < 1e-7L)
+      break;
+    uint64_t digits = (uint64_t)whole + (m - whole > 0.5L);
+    if (digits == 100000000000ULL){
+      digits = 10000000000ULL;
+      e10++;
+    }
+
+    size_t len = 0;
+    if (x < 0)
+      s[len++] = '-';
+    char *first = s + len;
+    for (int i = 11; i > 1; i--, digits /= 10)
+      first[i] = '0' + digits % 10;
+    first[0] = '0' + digits;
+    first[1] = '.';
+    len += 12;
+    s[len++] = 'e';
+    s[len++] = (e10 < 0) ? '-' : '+';
+    int power = abs(e10);
+    if (power >= 100)
+      s[len++] = '0' + power / 100;
+    s[len++] = '0' + power / 10 % 10;
+    s[len++] = '0' + power % 10;
+    return len;
+  }
+#endif
+  return snprintf(s, SURVEY_LINE / 2, "%.10e", x);
+}
+
+// Records of one chunk of the survey mode and their results.
+typedef struct {
+  char **lines;      // the records, each ended by '\0'
+  size_t count;
+  double height[SURVEY_CHUNK], alpha[SURVEY_CHUNK], beta[SURVEY_CHUNK];
+  double tan_a[SURVEY_CHUNK], tan_b[SURVEY_CHUNK];
+  char has_beta[SURVEY_CHUNK];
+  char out[SURVEY_CHUNK * SURVEY_LINE];
+  size_t out_len;
+  size_t error;      // the first wrong record, count if all of them are correct
+} survey_chunk;
+
+// Work of one thread of the survey mode: the chunks first, first + step, ... up to count.
+typedef struct {
+  survey_chunk *chunks;
+  size_t first, step, count;
+} survey_part;
+
+/* Function which reads a record "height,alpha[,beta]" into the i-th place of a chunk, returns 0 if it is wrong.
+   The height may be empty (1.5 m, as without -c) and so may beta (only the distance is counted). */
+int survey_record(survey_chunk *c, size_t i)
+{
+  char *s = c->lines[i], *end;
+  size_t len = strlen(s);
+
+  if (len > 0 && s[len-1] == '\r')
+    s[--len] = '\0';
+  c->height[i] = (*s == ',') ? 1.5 : strtod(s, &end);
+  if (*s != ',' && (end == s || *end != ','))
+    return 0;
+  s = strchr(s, ',') + 1;
+  c->alpha[i] = strtod(s, &end);
+  if (end == s || (*end != ',' && *end != '\0'))
+    return 0;
+  s = end;
+  c->has_beta[i] = s[0] == ',' && s[1] != '\0';
+  c->beta[i] = c->alpha[i]; // tan of it is counted in the batch, but not used
+  if (c->has_beta[i]){
+    c->beta[i] = strtod(s + 1, &end);
+    if (end == s + 1 || *end != '\0' || !correct_angle(c->beta[i]))
+      return 0;
+  }
+  return correct_height(c->height[i]) && correct_angle(c->alpha[i]);
+}
+
+/* Function which counts the distance and the height of the records of a chunk up to the first wrong one
+   and writes them as lines "distance,height" (the height is empty without beta) into the output of the chunk. */
+void survey_chunk_count(survey_chunk *c)
+{
+  c->error = c->count;
+  for (size_t i = 0; i < c->count; i++){
+    if (!survey_record(c, i)){
+      c->error = i;
+      break;
+    }
+  }
+  cfrac_tan_batch(c->alpha, c->tan_a, c->error, MAX_ITER);
+  cfrac_tan_batch(c->beta, c->tan_b, c->error, MAX_ITER);
+
+  char *out = c->out;
+  for (size_t i = 0; i < c->error; i++){
+    double d = c->height[i] / c->tan_a[i];
+    out += format_e10(out, d);
+    *out++ = ',';
+    if (c->has_beta[i])
+      out += format_e10(out, c->height[i] + c->tan_b[i] * d);
+    *out++ = '\n';
+  }
+  c->out_len = out - c->out;
+}
+
+// Function which counts the chunks of a part of the survey (the start function of its thread).
+void *survey_part_run(void *arg)
+{
+  survey_part *p = arg;
+
+  for (size_t i = p->first; i < p->count; i += p->step)
+    survey_chunk_count(&p->chunks[i]);
+  return NULL;
+}
+
+/* Function which counts count records by threads and writes their results in the order of the records.
+   Returns the number of the correct records before the first wrong one (count if there is none). */
+size_t survey_records(char **lines, size_t count, unsigned int threads)
+{
+  static survey_chunk chunks[SURVEY_MAX_THREADS];
+  survey_part parts[SURVEY_MAX_THREADS];
+  pthread_t ids[SURVEY_MAX_THREADS];
+  int started[SURVEY_MAX_THREADS];
+  size_t n = (count + SURVEY_CHUNK - 1) / SURVEY_CHUNK;
+
+  for (size_t i = 0; i < n; i++){
+    chunks[i].lines = lines + i * SURVEY_CHUNK;
+    chunks[i].count = (i + 1 < n) ? SURVEY_CHUNK : count - i * SURVEY_CHUNK;
+  }
+  if (threads > n)
+    threads = n;
+  if (threads == 0)
+    threads = 1;
+  for (unsigned int t = 0; t < threads; t++)
+    parts[t] = (survey_part){chunks, t, threads, n};
+
+  // A part whose thread cannot be created is counted by this thread.
+  for (unsigned int t = 1; t < threads; t++)
+    started[t] = pthread_create(&ids[t], NULL, survey_part_run, &parts[t]) == 0;
+  survey_part_run(&parts[0]);
+  for (unsigned int t = 1; t < threads; t++){
+    if (started[t])
+      pthread_join(ids[t], NULL);
+    else
+      survey_part_run(&parts[t]);
+  }
+
+  size_t correct = 0;
+  for (size_t i = 0; i < n; i++){
+    fwrite(chunks[i].out, 1, chunks[i].out_len, stdout);
+    correct += chunks[i].error;
+    if (chunks[i].error < chunks[i].count)
+      break;
+  }
+  return correct;
+}
+
+/* Function which counts the distance and the height of every record "height,alpha[,beta]" of a CSV file
+   (stdin if path is NULL) with threads, a line "distance,height" is written for each of them in the same order.
+   A first line which does not start with a number is a header, "distance,height" is written for it. */
+int survey(unsigned int threads, const char *path)
 {
-  double M = tan(tg);
+  static char buf[SURVEY_BLOCK + 1];
+  static char *lines[SURVEY_MAX_THREADS * SURVEY_CHUNK];
+  static char out[1 << 20];
+  size_t len = 0, line = 0; // bytes in buf, lines before them
+  int eof = 0, ok = 1;
+
+  FILE *f = (path == NULL) ? stdin : fopen(path, "r");
+  if (f == NULL){
+    fprintf(stderr, "The file %s could not be opened.\n", path);
+    return 0;
+  }
+  setvbuf(stdout, out, _IOFBF, sizeof(out)); // the results are written in large blocks
+
+  while (ok){
+    if (!eof && len < SURVEY_BLOCK){
+      size_t n = fread(buf + len, 1, SURVEY_BLOCK - len, f);
+      len += n;
+      eof = n == 0;
+    }
+
+    // Complete lines are cut out of the buffer, the last one also without a newline at the end of the input.
+    size_t start = 0, count = 0;
+    while (count < sizeof(lines) / sizeof(lines[0]) && start < len){
+      char *nl = memchr(buf + start, '\n', len - start);
+      if (nl == NULL && !eof)
+        break;
+      if (nl == NULL)
+        nl = buf + len;
+      *nl = '\0';
+      lines[count++] = buf + start;
+      start = nl - buf + 1;
+    }
+    if (start > len)
+      start = len;
+    if (count == 0){
+      if (len == SURVEY_BLOCK){
+        fprintf(stderr, "The line %zu is too long.\n", line + 1);
+        ok = 0;
+      }
+      if (eof)
+        break;
+      continue;
+    }
+
+    char **records = lines;
+    if (line == 0 && strchr("0123456789+-., \t", lines[0][0]) == NULL){
+      fputs("distance,height\n", stdout);
+      records++;
+      count--;
+      line++;
+    }
+    size_t correct = survey_records(records, count, threads);
+    if (correct < count){
+      fprintf(stderr, "The record on the line %zu is wrong, it has to be height,alpha[,beta] "
+                      "with the height in (0 ; 100> and the angles in (0 ; 1.4>.\n", line + correct + 1);
+      ok = 0;
+    }
+    line += count;
+    memmove(buf, buf + start, len - start);
+    len -= start;
+  }
+
+  if (ferror(f)){
+    fprintf(stderr, "The records could not be read.\n");
+    ok = 0;
+  }
+  if (f != stdin)
+    fclose(f);
+  if (fflush(stdout) != 0 || ferror(stdout)){
+    fprintf(stderr, "The results could not be written.\n");
+    ok = 0;
+  }
+  return ok;
+}
+
+/* Function which counts tan with n members of Taylor series and n iterations of continued fractions
+   in a precision, their results and the time of one evaluation in nanoseconds (TT, CT) are stored. */
+void tan_in_precision(precision prec, double tg, unsigned int n, long double *T, long double *C, double *TT, double *CT)
+{
+  volatile double angle = tg; // read for every evaluation, so it is not taken out of the loop
+
+  if (prec == PREC_QUAD){
+    volatile quad sink;
+    *T = taylor_tanq(tg, n);
+    *C = cfrac_tanq(tg, n);
+    TIME_TAN(TT, sink, taylor_tanq(angle, n));
+    TIME_TAN(CT, sink, cfrac_tanq(angle, n));
+  }
+  else if (prec == PREC_LONG){
+    volatile long double sink;
+    *T = taylor_tanl(tg, n);
+    *C = cfrac_tanl(tg, n);
+    TIME_TAN(TT, sink, taylor_tanl(angle, n));
+    TIME_TAN(CT, sink, cfrac_tanl(angle, n));
+  }
+  else {
+    volatile double sink;
+    *T = taylor_tan(tg, n);
+    *C = cfrac_tan(tg, n);
+    TIME_TAN(TT, sink, taylor_tan(angle, n));
+    TIME_TAN(CT, sink, cfrac_tan(angle, n));
+  }
+}
+
+/* Function which iteratively counts tan of an angle with various methods in a precision (in all of them
+   one after another for PREC_ALL). The errors are from tan(), tanl() or tanq() of the same precision. */
+int count_tan(double tg, unsigned int n, unsigned int m, precision prec)
+{
+  if (prec == PREC_ALL){
+    for (precision p = PREC_DOUBLE; p < PREC_ALL; p++){
+      printf("%s%s\n", (p > PREC_DOUBLE) ? "\n" : "", precision_names[p]);
+      count_tan(tg, n, m, p);
+    }
+    return 0;
+  }
+
+  long double M = (prec == PREC_QUAD) ? (long double)tanq(tg) : (prec == PREC_LONG) ? tanl(tg) : tan(tg);
+  quad MQ = tanq(tg); // the errors of __float128 are too small for long double differences
 
   for (;n <= m; n++){
-    double T = taylor_tan(tg, n);
-    double TE = fabs(T-M);
-    double C = cfrac_tan(tg, n);
-    double CE = fabs(C-M);
-    printf("%d %e %e %e %e %e\n", n, M, T, TE, C, CE);
+    long double T, C;
+    double TT, CT;
+    tan_in_precision(prec, tg, n, &T, &C, &TT, &CT);
+    long double TE = (prec == PREC_QUAD) ? (long double)fabsq(taylor_tanq(tg, n) - MQ) : fabsl(T-M);
+    long double CE = (prec == PREC_QUAD) ? (long double)fabsq(cfrac_tanq(tg, n) - MQ) : fabsl(C-M);
+    printf("%d %Le %Le %Le %Le %Le %.1f %.1f\n", n, M, T, TE, C, CE, TT, CT);
   }
   return 0;
 }
 
 // Function which counts distance when an angle is set in radians.
-int distance_a(double angle)
+int distance_a(double angle, const tan_error *e)
 {
-  printf("%.10e\n", 1.5 / cfrac_tan(angle, MAX_ITER));
+  print_measurement(1.5, angle, NULL, e);
   return 1;
 }
 
 // Function which counts distance and height when two angles are set in radians.
-int distance_height_ab(double angle_a, double angle_b)
+int distance_height_ab(double angle_a, double angle_b, const tan_error *e)
 {
-  double d = 1.5 / cfrac_tan(angle_a, MAX_ITER);
-  printf("%.10e\n", d);
-  printf("%.10e\n", 1.5 + cfrac_tan(angle_b, MAX_ITER) * d);
+  print_measurement(1.5, angle_a, &angle_b, e);
   return 1;
 }
 
 // Function which counts distance when a height and an angle in radians is set.
-int distance_ca(double height, double angle_a)
+int distance_ca(double height, double angle_a, const tan_error *e)
 {
-  double d = height / cfrac_tan(angle_a, MAX_ITER);
-  printf("%.10e\n", d);
+  print_measurement(height, angle_a, NULL, e);
   return 1;
 }
 
 // Function which counts distance and height when a height and two angles in radians are set.
-int distance_height_cab(double height, double angle_a, double angle_b)
+int distance_height_cab(double height, double angle_a, double angle_b, const tan_error *e)
 {
-  double d = height / cfrac_tan(angle_a, MAX_ITER);
-  printf("%.10e\n", d);
-  printf("%.10e\n", height + cfrac_tan(angle_b, MAX_ITER) * d);
+  print_measurement(height, angle_a, &angle_b, e);
+  return 1;
+}
+
+// Function which finds out if the arguments of the batch mode (after --batch) are correct.
+int correct_batch(int argc, char* argv[])
+{
+  int options = 3; // the first argument after METHOD N (after full for the full-range tan)
+
+  if (argc > 1 && strcmp(argv[1], "full") == 0)
+    options = 2;
+  else if (argc < 3 || (strcmp(argv[1], "cfrac") != 0 && strcmp(argv[1], "taylor") != 0))
+    return 0;
+  else if (str_to_int(argv[2]) <= TAN_MIN_ITER || str_to_int(argv[2]) >= TAN_MAX_ITER)
+    return 0;
+  if (argc > options + 2 || (argc == options + 2 && strcmp(argv[options], "-b") != 0))
+    return 0;
   return 1;
 }
 
@@ -179,11 +1414,20 @@ argoptions check_args(int argc, char* argv[])
   if (argc > 1){
     if ((argc == 2) && strcmp(argv[1], "--help") == 0)
       return HELP;
+    else if ((argc == 2) && strcmp(argv[1], "--tan-table") == 0)
+      return TAN_TABLE;
+    else if ((argc == 2 || (argc == 3 && str_to_int(argv[2]) > 0)) && strcmp(argv[1], "--tan-sweep") == 0)
+      return TAN_SWEEP;
     else if (argc == 5 && strcmp(argv[1], "--tan") == 0 && str_to_dbl(argv[2])
              && str_to_int(argv[3]) > TAN_MIN_ITER && str_to_int(argv[3]) < TAN_MAX_ITER
              && str_to_int(argv[4]) > TAN_MIN_ITER && str_to_int(argv[4]) < TAN_MAX_ITER
              && str_to_int(argv[3]) <= str_to_int(argv[4]))
       return TAN;
+    else if (strcmp(argv[1], "--batch") == 0 && correct_batch(argc - 1, argv + 1))
+      return BATCH;
+    else if ((argc == 3 || argc == 4) && strcmp(argv[1], "--survey") == 0
+             && str_to_int(argv[2]) > 0 && str_to_int(argv[2]) <= SURVEY_MAX_THREADS)
+      return SURVEY;
     else if (argc == 3 && strcmp(argv[1], "-m") == 0
              && correct_angle(str_to_dbl(argv[2])))
       return DIST_A;
@@ -203,11 +1447,57 @@ argoptions check_args(int argc, char* argv[])
   else
     return NO_ARGS;
 }
-
+
 int main(int argc, char* argv[])
 {
+  tan_error e = {0, 0, PREC_DOUBLE};
+  int prec_set = 0;
+
+  /* The required error of the measurement (-e absolute, -r relative) and the precision are taken out
+     before the other arguments. */
+  while (argc > 2 && (strcmp(argv[1], "-e") == 0 || strcmp(argv[1], "-r") == 0
+                      || strcmp(argv[1], "--precision") == 0)){
+    if (strcmp(argv[1], "--precision") == 0){
+      for (e.prec = PREC_DOUBLE; e.prec <= PREC_ALL && strcmp(argv[2], precision_names[e.prec]) != 0; e.prec++)
+        ;
+      if (e.prec > PREC_ALL){
+        fprintf(stderr, "The precision has to be double, long, quad or all.\n");
+        return EXIT_FAILURE;
+      }
+      prec_set = 1;
+    }
+    else {
+      e.err = str_to_dbl(argv[2]);
+      e.rel = argv[1][1] == 'r';
+      if (!(e.err > 0)){
+        fprintf(stderr, "The required error has to be a positive number.\n");
+        return EXIT_FAILURE;
+      }
+    }
+    argv[2] = argv[0];
+    argc -= 2;
+    argv += 2;
+  }
+
   // Chooses appropriate behavior of the program based on the input arguments.
-  switch(check_args(argc, argv)){
+  argoptions option = check_args(argc, argv);
+  int measurement = option == DIST_A || option == DIST_H_AB || option == DIST_CA || option == DIST_H_CAB;
+  if (e.err > 0 && !measurement)
+    option = GENERAL_ERROR; // the error is required only for the measurement
+  if (prec_set && !(option == TAN || (measurement && e.prec != PREC_ALL)))
+    option = GENERAL_ERROR; // the precision is chosen only for the comparison and the measurement
+  init_extended_coefs();
+  if (e.err > 0 && option != GENERAL_ERROR){
+    int angles = (option == DIST_CA || option == DIST_H_CAB) ? 4 : 2;
+    for (int i = angles; i < argc; i++){
+      if (cfrac_iterations(str_to_dbl(argv[i]), e.err, e.rel) == 0){
+        fprintf(stderr, "The error %g cannot be reached for the angle %s.\n", e.err, argv[i]);
+        return EXIT_FAILURE;
+      }
+    }
+  }
+
+  switch(option){
     case NO_ARGS:
       fprintf(stderr, "No argument was set.\n"
                       "Use argument --help for program function explanation.\n");
@@ -216,24 +1506,39 @@ int main(int argc, char* argv[])
       print_help();
       return EXIT_SUCCESS;
     case TAN:
-      count_tan(str_to_dbl(argv[2]), str_to_int(argv[3]), str_to_int(argv[4]));
+      count_tan(str_to_dbl(argv[2]), str_to_int(argv[3]), str_to_int(argv[4]), e.prec);
+      return EXIT_SUCCESS;
+    case BATCH:
+    {
+      int options = (strcmp(argv[2], "full") == 0) ? 3 : 4;
+      int binary = argc > options && strcmp(argv[options], "-b") == 0;
+      const char *path = (argc > options + binary) ? argv[options + binary] : NULL;
+      unsigned int n = (options == 4) ? str_to_int(argv[3]) : 0;
+      return batch_tan(argv[2], n, binary, path) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    case SURVEY:
+      return survey(str_to_int(argv[2]), (argc == 4) ? argv[3] : NULL) ? EXIT_SUCCESS : EXIT_FAILURE;
+    case TAN_SWEEP:
+      return tan_sweep_bench((argc == 3) ? (size_t)str_to_int(argv[2]) : SWEEP_ANGLES) ? EXIT_SUCCESS : EXIT_FAILURE;
+    case TAN_TABLE:
+      print_tan_table();
       return EXIT_SUCCESS;
     case DIST_A:
-      distance_a(str_to_dbl(argv[2]));
+      distance_a(str_to_dbl(argv[2]), &e);
       return EXIT_SUCCESS;
     case DIST_H_AB:
-      distance_height_ab(str_to_dbl(argv[2]), str_to_dbl(argv[3]));
+      distance_height_ab(str_to_dbl(argv[2]), str_to_dbl(argv[3]), &e);
       return EXIT_SUCCESS;
     case DIST_CA:
-      distance_ca(str_to_dbl(argv[2]), str_to_dbl(argv[4]));
+      distance_ca(str_to_dbl(argv[2]), str_to_dbl(argv[4]), &e);
       return EXIT_SUCCESS;
     case DIST_H_CAB:
-      distance_height_cab(str_to_dbl(argv[2]), str_to_dbl(argv[4]), str_to_dbl(argv[5]));
+      distance_height_cab(str_to_dbl(argv[2]), str_to_dbl(argv[4]), str_to_dbl(argv[5]), &e);
       return EXIT_SUCCESS;
     case GENERAL_ERROR:
       fprintf(stderr, "Something is wrong with the input - use argument --help for help.\n");
       return EXIT_FAILURE;
     default:
       return EXIT_SUCCESS;
-  }
+  }
 }
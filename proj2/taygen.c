@@ -0,0 +1,257 @@
+/********************************************************************/
+/*                                                                  */
+/*  File: taygen.c                                                  */
+/*  Date: 19. 11. 2017                                              */
+/*  Author: Dominik Vecera, xvecer23@stud.fit.vutbr.cz              */
+/*  Project: Iterative computations                                 */
+/*                                                                  */
+/*  Generator of tan_coefs.h (make): taygen N > tan_coefs.h         */
+/*  The first N coefficients of Taylor series of tan(x) are         */
+/*  computed exactly from tangent numbers and rounded to doubles,   */
+/*  and also split into three doubles for the extended precisions.  */
+/*                                                                  */
+/********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#define MAX_TERMS 700 // the coefficients of more members are too small for a double
+
+// Nonnegative integer of any size, limbs of 32 bits from the lowest one.
+typedef struct {
+  uint32_t *limb;
+  size_t len;
+  size_t cap;
+} bignum;
+
+// Function which makes sure that a number has space for cap limbs.
+void big_reserve(bignum *a, size_t cap)
+{
+  if (cap <= a->cap)
+    return;
+  a->limb = realloc(a->limb, cap * sizeof(*a->limb));
+  if (a->limb == NULL){
+    fprintf(stderr, "Not enough memory.\n");
+    exit(EXIT_FAILURE);
+  }
+  memset(a->limb + a->cap, 0, (cap - a->cap) * sizeof(*a->limb));
+  a->cap = cap;
+}
+
+// Function which sets a number to a small value.
+void big_set(bignum *a, uint32_t value)
+{
+  big_reserve(a, 1);
+  a->limb[0] = value;
+  a->len = value ? 1 : 0;
+}
+
+// Function which copies the number b into a.
+void big_copy(bignum *a, const bignum *b)
+{
+  big_reserve(a, b->len + 1);
+  memcpy(a->limb, b->limb, b->len * sizeof(*b->limb));
+  a->len = b->len;
+}
+
+// Function which multiplies a number by a small value.
+void big_mul(bignum *a, uint32_t m)
+{
+  uint64_t carry = 0;
+
+  for (size_t i = 0; i < a->len; i++){
+    carry += (uint64_t)a->limb[i] * m;
+    a->limb[i] = (uint32_t)carry;
+    carry >>= 32;
+  }
+  if (carry){
+    big_reserve(a, a->len + 1);
+    a->limb[a->len++] = (uint32_t)carry;
+  }
+  while (a->len > 0 && a->limb[a->len - 1] == 0)
+    a->len--;
+}
+
+// Function which adds the number b to a.
+void big_add(bignum *a, const bignum *b)
+{
+  uint64_t carry = 0;
+  size_t len = (a->len > b->len) ? a->len : b->len;
+
+  big_reserve(a, len + 1);
+  for (size_t i = 0; i < len; i++){
+    carry += (uint64_t)a->limb[i] + ((i < b->len) ? b->limb[i] : 0);
+    a->limb[i] = (uint32_t)carry;
+    carry >>= 32;
+  }
+  a->len = len;
+  if (carry)
+    a->limb[a->len++] = (uint32_t)carry;
+}
+
+// Function which divides a number by a small value, returns 1 if there is a remainder.
+int big_div(bignum *a, uint32_t d)
+{
+  uint64_t rem = 0;
+
+  for (size_t i = a->len; i > 0; i--){
+    rem = (rem << 32) | a->limb[i-1];
+    a->limb[i-1] = (uint32_t)(rem / d);
+    rem %= d;
+  }
+  while (a->len > 0 && a->limb[a->len - 1] == 0)
+    a->len--;
+  return rem != 0;
+}
+
+// Function which multiplies a number by 2^shift.
+void big_shift(bignum *a, size_t shift)
+{
+  size_t words = shift / 32;
+  unsigned bits = shift % 32;
+
+  big_reserve(a, a->len + words + 1);
+  memmove(a->limb + words, a->limb, a->len * sizeof(*a->limb));
+  memset(a->limb, 0, words * sizeof(*a->limb));
+  a->len += words;
+  a->limb[a->len] = 0;
+  if (bits){
+    for (size_t i = a->len + 1; i > words; i--)
+      a->limb[i-1] = (a->limb[i-1] << bits) | ((i-1 > words) ? a->limb[i-2] >> (32 - bits) : 0);
+    a->len++;
+  }
+  while (a->len > 0 && a->limb[a->len - 1] == 0)
+    a->len--;
+}
+
+// Function which returns the number of bits of a number.
+size_t big_bits(const bignum *a)
+{
+  size_t bits = a->len * 32;
+
+  if (a->len == 0)
+    return 0;
+  for (uint32_t top = a->limb[a->len - 1]; !(top & 0x80000000u); top <<= 1)
+    bits--;
+  return bits;
+}
+
+// Function which returns the bit i of a number.
+int big_bit(const bignum *a, size_t i)
+{
+  return (i / 32 < a->len) ? (a->limb[i / 32] >> (i % 32)) & 1 : 0;
+}
+
+/* Function which computes t / (2k+1)! with at least 170 bits into q, the quotient is q / 2^(*shift).
+   t * 2^shift is divided by 1, 2, ..., 2k+1 in turn (the floor of the floors is the floor of the quotient).
+   Returns 1 if the quotient is not exact. */
+int quotient(const bignum *t, uint32_t k, bignum *q, size_t *shift)
+{
+  double log2_factorial = 0;
+  int sticky = 0;
+
+  for (uint32_t j = 2; j <= 2*k + 1; j++)
+    log2_factorial += log2(j);
+  *shift = (size_t)log2_factorial + 170 - big_bits(t) + 2 * k + 2; // t / (2k+1)! >= (2/pi)^(2k+2)
+  big_copy(q, t);
+  big_shift(q, *shift);
+  for (uint32_t j = 2; j <= 2*k + 1; j++)
+    sticky |= big_div(q, j);
+  return sticky;
+}
+
+// Function which returns the 53 bits of a number below the bit top (exclusive) as an integer.
+uint64_t big_bits53(const bignum *q, size_t top)
+{
+  uint64_t m = 0;
+
+  for (size_t i = 1; i <= 53; i++)
+    m = (m << 1) | big_bit(q, top - i);
+  return m;
+}
+
+/* Function which prints the coefficient t / (2k+1)! rounded to the nearest double (ties to even) and
+   the same coefficient as the sum of three doubles (truncated to 159 bits) for long double and __float128. */
+void print_coefficient(const bignum *t, uint32_t k, double *ext)
+{
+  bignum q = {NULL, 0, 0};
+  size_t shift;
+  int sticky = quotient(t, k, &q, &shift);
+  size_t bits = big_bits(&q);
+
+  uint64_t m = big_bits53(&q, bits);
+  int guard = big_bit(&q, bits - 54);
+  for (size_t i = 0; i + 54 < bits && !sticky; i++)
+    sticky = big_bit(&q, i);
+  if (guard && (sticky || (m & 1)))
+    m++;
+  printf("  %a,\n", ldexp((double)m, (int)bits - 53 - (int)shift));
+
+  for (int i = 0; i < 3; i++)
+    ext[i] = ldexp((double)big_bits53(&q, bits - 53 * i), (int)bits - 53 * (i + 1) - (int)shift);
+  free(q.limb);
+}
+
+int main(int argc, char* argv[])
+{
+  char *end;
+
+  if (argc != 2){
+    fprintf(stderr, "Usage: taygen N > tan_coefs.h\n");
+    return EXIT_FAILURE;
+  }
+  long n = strtol(argv[1], &end, 10);
+  if (*end != '\0' || n < 1 || n > MAX_TERMS){
+    fprintf(stderr, "The number of members has to be from 1 to %d.\n", MAX_TERMS);
+    return EXIT_FAILURE;
+  }
+
+  // Tangent numbers T(2k+1) (1, 2, 16, 272, ...) by the triangle of Knuth and Buckholtz, t[k] = T(2k+1).
+  bignum *t = calloc(n, sizeof(*t));
+  bignum term = {NULL, 0, 0};
+  if (t == NULL){
+    fprintf(stderr, "Not enough memory.\n");
+    return EXIT_FAILURE;
+  }
+  big_set(&t[0], 1);
+  for (long k = 1; k < n; k++){
+    big_copy(&t[k], &t[k-1]);
+    big_mul(&t[k], k);
+  }
+  for (long k = 1; k < n; k++){
+    for (long j = k; j < n; j++){
+      big_copy(&term, &t[j-1]);
+      big_mul(&term, j - k);
+      big_mul(&t[j], j - k + 2);
+      big_add(&t[j], &term);
+    }
+  }
+
+  printf("/* Generated by taygen %ld, do not edit: the coefficients of Taylor series\n"
+         "   tan(x) = sum of tan_coefs[k] * x^(2k+1), tan_coefs[k] = T(2k+1) / (2k+1)! for the tangent numbers T,\n"
+         "   computed exactly and rounded to the nearest double. */\n\n"
+         "#define TAN_TERMS %ld\n\n"
+         "static const double tan_coefs[TAN_TERMS] = {\n", n, n);
+  double (*ext)[3] = malloc(n * sizeof(*ext));
+  if (ext == NULL){
+    fprintf(stderr, "Not enough memory.\n");
+    return EXIT_FAILURE;
+  }
+  for (long k = 0; k < n; k++){
+    print_coefficient(&t[k], k, ext[k]);
+    free(t[k].limb);
+  }
+  printf("};\n\n"
+         "// The coefficients as sums of three doubles (159 bits) for the long double and __float128 series.\n"
+         "static const double tan_coefs_ext[TAN_TERMS][3] = {\n");
+  for (long k = 0; k < n; k++)
+    printf("  {%a, %a, %a},\n", ext[k][0], ext[k][1], ext[k][2]);
+  printf("};\n");
+  free(ext);
+  free(t);
+  free(term.limb);
+  return fflush(stdout) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,43 @@
+#!/bin/sh
+# Porovna vystup shlukovani v jedinem procesu s vystupem --workers P.
+# Objekty lezi na mrizce, takze vzdalenosti shluku se casto shoduji.
+#
+# Pouziti: ./check_workers.sh [PROGRAM] [POCET_MRIZEK]
+
+PROG=${1:-./proj3}
+RUNS=${2:-40}
+TMP=$(mktemp -d) || exit 1
+trap 'rm -rf "$TMP"' EXIT
+
+failed=0
+run=0
+while [ "$run" -lt "$RUNS" ]; do
+  # mrizka x v {0,3,...,18}, y v {0,7,...,42}, 20 az 40 objektu
+  awk -v seed="$run" 'BEGIN {
+    srand(seed + 1)
+    n = 20 + int(rand() * 21)
+    print "count=" n
+    for (i = 0; i < n; i++)
+      print i + 1, 3 * int(rand() * 7), 7 * int(rand() * 7)
+  }' > "$TMP/grid"
+
+  for method in --avg --min --max; do
+    for n in 1 3 7; do
+      "$PROG" "$TMP/grid" $n $method > "$TMP/serial" || exit 1
+      for p in 1 2 3 5; do
+        "$PROG" "$TMP/grid" $n $method --workers $p > "$TMP/sharded" || exit 1
+        if ! cmp -s "$TMP/serial" "$TMP/sharded"; then
+          echo "rozdil: mrizka $run, N=$n $method --workers $p"
+          failed=$((failed + 1))
+        fi
+      done
+    done
+  done
+  run=$((run + 1))
+done
+
+if [ "$failed" -ne 0 ]; then
+  echo "$failed behu se --workers se lisi od shlukovani v jednom procesu"
+  exit 1
+fi
+echo "vsech $((RUNS * 36)) behu se --workers odpovida shlukovani v jednom procesu"
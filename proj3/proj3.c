@@ -5,12 +5,27 @@
  * Unweighted pair-group average
  * https://is.muni.cz/th/172767/fi_b/5739129/web/web/usrov.html
  */
+#define _DEFAULT_SOURCE // fork, pipe, mmap s MAP_ANONYMOUS
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
 #include <math.h> // sqrtf
 #include <limits.h> // INT_MAX
 #include <string.h>
+#include <errno.h> // ERANGE
+#include <unistd.h> // fork, pipe
+#include <sys/mman.h> // mmap
+#include <sys/wait.h> // waitpid
+#include <signal.h> // kill
+/* Metriky (--metrics) pocitaji silhouette a kofeneticke soucty paralelne
+   pomoci OpenMP jen pri prekladu s prepinacem -fopenmp, napr.:
+     gcc -std=c99 -Wall -Wextra -Werror -DNDEBUG -fopenmp proj3.c -o proj3 -lm
+   Bez nej se _OPENMP nedefinuje, pragmy se ignoruji a metriky se pocitaji
+   v jedinem vlakne (vysledek se muze lisit jen zaokrouhlenim souctu). */
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 /*****************************************************************
  * Ladici makra. Vypnout jejich efekt lze definici makra
@@ -54,9 +69,23 @@
 */
 #define MAX_OBJECT_COUNT_LINE_LENGTH 16
 
+/* Maximalni delka identifikatoru objektu ve vstupnim souboru. Identifikatory
+   jsou 64bitova cela cisla, nejdelsi z nich (-9223372036854775808) ma
+   20 znaku.
+*/
+#define MAX_ID_LENGTH 20
+
 #define MIN_COORDINATE 0
 #define MAX_COORDINATE 1000 // souradnice X a Y musi byt mezi 0 a 1000 vcetne
 
+/* Maximalni delka retezce s poctem dimenzi na volitelnem druhem radku
+   vstupniho souboru ve tvaru dim=D.
+*/
+#define MAX_DIMENSION_LINE_LENGTH 16
+
+#define DEFAULT_DIMENSION 2 // pokud neni zadan radek dim=D, objekty jsou 2D
+#define MAX_DIMENSION 1024
+
 /*****************************************************************
  * Definice typu pro globalni promennou potrebnou k urceni
  * pozadovane metody shlukovani.
@@ -69,6 +98,53 @@ typedef enum {
 } caseoptions;
 caseoptions premium_case = AVG;
 
+/*****************************************************************
+ * Globalni promenne pro objekty s vice nez dvema dimenzemi.
+ *
+ *   dimension - pocet souradnic kazdeho objektu (dim=D ve vstupnim souboru),
+ *   coord_pool - pole vsech souradnic, pro kazdy objekt 'dimension' hodnot
+ *      za sebou v poradi jejich indexu; pro 2D objekty se nepouziva
+ *      (souradnice jsou v x a y).
+ */
+
+int dimension = DEFAULT_DIMENSION;
+float *coord_pool = NULL;
+
+/*****************************************************************
+ * Tabulka puvodnich identifikatoru objektu.
+ *
+ * Objekty si ve strukture obj_t nesou misto puvodniho (az 64bitoveho)
+ * identifikatoru jen husty index 0..N-1, prideleny podle poradi puvodnich
+ * identifikatoru. Razeni podle indexu tedy odpovida razeni podle puvodnich
+ * identifikatoru, ktere jsou potreba az pri tisku.
+ */
+
+long long *id_table = NULL;
+
+/*****************************************************************
+ * Maximalni vzdalenost dvou shluku, ktere se jeste smi sloucit
+ * (argument --max-merge-distance). Vychozi hodnota shlukovani neomezuje.
+ */
+
+float max_merge_distance = INFINITY;
+
+/*****************************************************************
+ * Nastaveni metrik kvality shlukovani (argumenty --metrics
+ * a --metrics-sample K). Hodnota 0 u 'metrics_sample' znamena, ze se
+ * metriky pocitaji ze vsech objektu.
+ */
+
+int metrics_enabled = 0;
+int metrics_sample = 0;
+
+/*****************************************************************
+ * Pocet pomocnych procesu, mezi ktere se rozdeli hledani nejblizsich
+ * shluku (argument --workers P). Hodnota 0 znamena hledani v jedinem
+ * procesu pomoci find_neighbours().
+ */
+
+int shard_workers = 0;
+
 /*****************************************************************
  * Deklarace potrebnych datovych typu:
  *
@@ -83,7 +159,7 @@ caseoptions premium_case = AVG;
  */
 
 struct obj_t {
-    int id;
+    int id; // husty index objektu, puvodni identifikator je v 'id_table'
     float x;
     float y;
 };
@@ -129,7 +205,19 @@ void print_help()
          "pozadovanou metodu shlukovani, ktery muze mit tyto hodnoty:\n"
          "--avg - metoda \"Unweighted pair-group average\" (vychozi),\n"
          "--min - metoda nejblizsiho souseda,\n"
-         "--max - metoda nejvzdalenejsiho souseda.\n");
+         "--max - metoda nejvzdalenejsiho souseda.\n\n"
+         "Za souborem lze kdekoli uvest take argument\n"
+         "--max-merge-distance D\n"
+         "ktery ukonci shlukovani, jakmile jsou dva nejblizsi shluky\n"
+         "vzdalenejsi nez D (D >= 0), i kdyz jeste nebylo dosazeno poctu N.\n\n"
+         "Argument --metrics vypise za shluky metriky kvality shlukovani:\n"
+         "silhouette score vyslednych shluku a kofeneticky korelacni\n"
+         "koeficient dvojic objektu, ktere byly behem shlukovani slouceny.\n"
+         "Argument --metrics-sample K (K > 0) pocita metriky pouze\n"
+         "z nahodneho vzorku K objektu, coz je vhodne pro velke soubory.\n\n"
+         "Argument --workers P (P > 0) rozdeli matici vzdalenosti shluku\n"
+         "ve sdilene pameti mezi P pomocnych procesu, ktere hledaji\n"
+         "nejblizsi shluky kazdy ve sve casti matice.\n");
 }
 
 /*
@@ -145,9 +233,15 @@ void print_file_help()
            "Pocet radku souboru odpovida nejmene poctu objektu + 1 (1. radek).\n"
            "Dalsi radky jsou ignorovany. Radek definujici objekt je formatu:\n"
            "OBJID X Y\n"
-           "kde OBJID je v ramci souboru jednoznacny celociselny identifikator,\n"
+           "kde OBJID je v ramci souboru jednoznacny celociselny (64bitovy)\n"
+           "identifikator,\n"
            "X a Y jsou souradnice objektu take cela cisla.\n"
-           "Plati 0 <= X <= 1000, 0 <= Y <= 1000.\n");
+           "Plati 0 <= X <= 1000, 0 <= Y <= 1000.\n\n"
+           "Objekty mohou mit i vice dimenzi. V tom pripade nasleduje za prvnim\n"
+           "radkem radek ve formatu \"dim=D\", kde D je pocet souradnic\n"
+           "kazdeho objektu (2 <= D <= 1024), a radek objektu ma tvar:\n"
+           "OBJID X1 X2 ... XD\n"
+           "Pro vsechny souradnice plati 0 <= Xi <= 1000.\n");
 }
 
 /*
@@ -280,6 +374,78 @@ void clear_all_clusters(struct cluster_t *carr, int narr)
     carr = NULL;
 }
 
+/*
+ Pocita Euklidovskou vzdalenost dvou vektoru o 'n' souradnicich. Soucty
+ ctvercu se stridaji do 4 nezavislych mezisouctu, aby je prekladac mohl
+ vektorizovat i bez preskupovani operaci v plovouci radove carce.
+ */
+static inline float distance_nd(const float *a, const float *b, const int n)
+{
+    float sum[4] = {0.0, 0.0, 0.0, 0.0};
+    int i = 0;
+
+    for (; i + 4 <= n; i += 4){
+      for (int l = 0; l < 4; l++){
+        float d = a[i+l] - b[i+l];
+        sum[l] += d * d;
+      }
+    }
+    for (; i < n; i++){
+      float d = a[i] - b[i];
+      sum[0] += d * d;
+    }
+
+    return sqrtf((sum[0] + sum[1]) + (sum[2] + sum[3]));
+}
+
+/*
+ Specializovane vypocty vzdalenosti pro pevne dany pocet dimenzi. Pocet
+ souradnic je znamy v dobe prekladu, smycky v distance_nd() jsou tedy
+ po vlozeni funkce plne rozbalene.
+ */
+#define DEFINE_DISTANCE_KERNEL(D) \
+static float distance_kernel_##D(const float *a, const float *b) \
+{ \
+    return distance_nd(a, b, D); \
+}
+
+DEFINE_DISTANCE_KERNEL(3)
+DEFINE_DISTANCE_KERNEL(4)
+DEFINE_DISTANCE_KERNEL(8)
+DEFINE_DISTANCE_KERNEL(16)
+
+// obecna varianta pro ostatni pocty dimenzi
+static float distance_kernel_generic(const float *a, const float *b)
+{
+    return distance_nd(a, b, dimension);
+}
+
+// vypocet vzdalenosti pro objekty s vice nez 2 dimenzemi
+static float (*distance_kernel)(const float *, const float *) =
+    &distance_kernel_generic;
+
+/*
+ Vybere vypocet vzdalenosti odpovidajici poctu dimenzi 'dim'.
+ */
+void select_distance_kernel(int dim)
+{
+    switch (dim){
+      case 3:  distance_kernel = &distance_kernel_3;  break;
+      case 4:  distance_kernel = &distance_kernel_4;  break;
+      case 8:  distance_kernel = &distance_kernel_8;  break;
+      case 16: distance_kernel = &distance_kernel_16; break;
+      default: distance_kernel = &distance_kernel_generic;
+    }
+}
+
+/*
+ Vraci ukazatel na vsechny souradnice objektu 'o' (pouze pro D > 2).
+ */
+static inline const float *obj_coords(const struct obj_t *o)
+{
+    return &coord_pool[(size_t)o->id * dimension];
+}
+
 /*
  Pocita Euklidovskou vzdalenost mezi dvema objekty.
  */
@@ -288,6 +454,9 @@ float obj_distance(struct obj_t *o1, struct obj_t *o2)
     assert(o1 != NULL);
     assert(o2 != NULL);
 
+    if (dimension != 2)
+      return distance_kernel(obj_coords(o1), obj_coords(o2));
+
     float x = (o1->x - o2->x);
     x *= x;
     float y = (o1->y - o2->y);
@@ -297,9 +466,12 @@ float obj_distance(struct obj_t *o1, struct obj_t *o2)
 }
 
 /*
- Pocita vzdalenost dvou shluku.
+ Pocita vzdalenost dvou shluku. Jakmile je jiste, ze vzdalenost presahne
+ mez 'bound', vypocet se ukonci a vrati se nektera hodnota vetsi nez
+ 'bound' (ne nutne presna vzdalenost shluku).
 */
-float cluster_distance(struct cluster_t *c1, struct cluster_t *c2)
+float cluster_distance_bounded(struct cluster_t *c1, struct cluster_t *c2,
+                               float bound)
 {
     assert(c1 != NULL);
     assert(c1->size > 0);
@@ -332,29 +504,48 @@ float cluster_distance(struct cluster_t *c1, struct cluster_t *c2)
             if (temp_dist > cluster_dist)
               cluster_dist = temp_dist;
           }
+
+          // maximum uz muze jen rust
+          if (cluster_dist > bound)
+            break;
         }
         break;
 
       case AVG:
       default:
 
-        for (int i = 0; i < c1->size; i++)
+        for (int i = 0; i < c1->size; i++) {
           for (int j = 0; j < c2->size; j++)
             temp_dist += obj_distance(&c1->obj[i], &c2->obj[j]);
 
+          // soucet nezapornych vzdalenosti uz muze jen rust
+          if (temp_dist/(c1->size*c2->size) > bound)
+            break;
+        }
+
         cluster_dist = temp_dist/(c1->size*c2->size);
     }
 
     return cluster_dist;
 }
 
+/*
+ Pocita vzdalenost dvou shluku.
+*/
+float cluster_distance(struct cluster_t *c1, struct cluster_t *c2)
+{
+    return cluster_distance_bounded(c1, c2, INFINITY);
+}
+
 /*
  Funkce najde dva nejblizsi shluky. V poli shluku 'carr' o velikosti 'narr'
  hleda dva nejblizsi shluky. Nalezene shluky identifikuje jejich indexy v poli
  'carr'. Funkce nalezene shluky (indexy do pole 'carr') uklada do pameti na
- adresu 'c1' resp. 'c2'.
+ adresu 'c1' resp. 'c2' a vraci jejich vzdalenost. Pokud je zadana
+ maximalni vzdalenost slucovanych shluku a zadna dvojice ji nesplnuje,
+ vraci nejakou hodnotu vetsi nez tato mez.
 */
-void find_neighbours(struct cluster_t *carr, int narr, int *c1, int *c2)
+float find_neighbours(struct cluster_t *carr, int narr, int *c1, int *c2)
 {
     assert(narr > 0);
 
@@ -362,23 +553,29 @@ void find_neighbours(struct cluster_t *carr, int narr, int *c1, int *c2)
     if (narr == 1){
         *c1 = 0;
         *c2 = 0;
-        return;
+        return 0;
     }
 
-    float temp_dist, dist_min = -1;
+    float temp_dist, dist_min = -1, bound = max_merge_distance;
 
     for (int i = 0; i < narr; i++){
       for (int j = i + 1; j < narr; j++){
 
-        temp_dist = cluster_distance(&carr[i], &carr[j]);
+        // dvojice vzdalenejsi nez 'bound' uz nemohou byt nejblizsi
+        temp_dist = cluster_distance_bounded(&carr[i], &carr[j], bound);
 
         if (temp_dist < dist_min || dist_min == -1){
           *c1 = i;
           *c2 = j;
           dist_min = temp_dist;
+
+          if (dist_min < bound)
+            bound = dist_min;
         }
       }
     }
+
+    return dist_min;
 }
 
 // pomocna funkce pro razeni shluku
@@ -410,7 +607,17 @@ void print_cluster(struct cluster_t *c)
     for (int i = 0; i < c->size; i++)
     {
         if (i) putchar(' ');
-        printf("%d[%g,%g]", c->obj[i].id, c->obj[i].x, c->obj[i].y);
+        if (dimension == 2){
+          printf("%lld[%g,%g]", id_table[c->obj[i].id], c->obj[i].x,
+                 c->obj[i].y);
+          continue;
+        }
+
+        const float *coords = obj_coords(&c->obj[i]);
+        printf("%lld[%g", id_table[c->obj[i].id], coords[0]);
+        for (int k = 1; k < dimension; k++)
+          printf(",%g", coords[k]);
+        putchar(']');
     }
     putchar('\n');
 }
@@ -429,15 +636,34 @@ int str_to_int(const char *s)
       return 0;
 }
 
+/*
+ Funkce, ktera prevadi retezec na 64bitovy identifikator objektu 'id'.
+ Vraci 1, pokud je retezec platne cele cislo, jinak 0.
+*/
+int str_to_id(const char *s, long long *id)
+{
+    char *endptr;
+    errno = 0;
+    *id = strtoll(s, &endptr, 10);
+
+    return endptr != s && endptr[0] == '\0' && errno != ERANGE;
+}
+
 /*
  Funkce informujici uzivatele o spatne souradnici ve vstupnim souboru
- a provadejici prislusne ukoncovaci akce.
+ a provadejici prislusne ukoncovaci akce. Parametr 'axis' je poradi
+ souradnice na radku (0 = X, 1 = Y, ...).
 */
-void invalid_coordinate(int line, const char *filename, char c, FILE *fr)
+void invalid_coordinate(int line, const char *filename, int axis, FILE *fr)
 {
-    fprintf(stderr, "Na radku %d v souboru \"%s\" je neplatna "
-                "souradnice %c. X i Y musi byt v rozmezi 0-1000 vcetne.\n",
-                line, filename, c);
+    if (dimension == 2)
+      fprintf(stderr, "Na radku %d v souboru \"%s\" je neplatna "
+                  "souradnice %c. X i Y musi byt v rozmezi 0-1000 vcetne.\n",
+                  line, filename, axis == 0 ? 'X' : 'Y');
+    else
+      fprintf(stderr, "Na radku %d v souboru \"%s\" je neplatna "
+                  "%d. souradnice. Vsechny souradnice musi byt v rozmezi "
+                  "0-1000 vcetne.\n", line, filename, axis + 1);
     print_file_help();
     fclose(fr);
 }
@@ -477,6 +703,141 @@ int get_object_count_from_first_line(FILE *fr)
     return object_count;
 }
 
+/*
+ Funkce zjistujici pocet dimenzi objektu z volitelneho radku "dim=D"
+ nasledujiciho za prvnim radkem. Pokud radek chybi, vraci vychozi pocet
+ dimenzi, jinak zvysi cislo radku 'line'. V pripade chyby vraci -1.
+*/
+int get_dimension_from_second_line(FILE *fr, int *line)
+{
+    int c = getc(fr);
+    ungetc(c, fr);
+    if (c != 'd')
+      return DEFAULT_DIMENSION;
+
+    char dim_line[MAX_DIMENSION_LINE_LENGTH];
+    fscanf(fr, "%15s", dim_line);
+
+    if (strncmp(dim_line, "dim=", 4) != 0){
+      print_error("Druhy radek souboru neni v pozadovanem formatu \"dim=D\".\n");
+      fclose(fr);
+      return -1;
+    }
+
+    if ((c = getc(fr)) != '\n' && c != EOF && c != '\r'){
+      print_error("V souboru se vyskytl nevalidni radek.\n");
+      print_file_help();
+      fclose(fr);
+      return -1;
+    }
+
+    int dim = str_to_int(dim_line + 4);
+    if (dim < 2 || dim > MAX_DIMENSION){
+      print_error("Pocet dimenzi objektu musi byt v rozmezi 2-1024.\n");
+      fclose(fr);
+      return -1;
+    }
+
+    (*line)++;
+    return dim;
+}
+
+
+/*
+ Nacte ze souboru 'dimension' souradnic jednoho objektu do pole 'coords'.
+ Vraci 1, pokud se podarilo nacist vsechny souradnice, jinak 0.
+*/
+int read_coordinates(FILE *fr, float *coords)
+{
+    for (int k = 0; k < dimension; k++){
+      if (fscanf(fr, " %4f", &coords[k]) != 1)
+        return 0;
+    }
+
+    return 1;
+}
+
+// polozka pro razeni puvodnich identifikatoru
+struct id_entry {
+    long long id;
+    int index; // poradi objektu ve vstupnim souboru
+};
+
+// pomocna funkce pro razeni puvodnich identifikatoru
+static int id_entry_compar(const void *a, const void *b)
+{
+    const struct id_entry *e1 = (const struct id_entry *)a;
+    const struct id_entry *e2 = (const struct id_entry *)b;
+    if (e1->id < e2->id) return -1;
+    if (e1->id > e2->id) return 1;
+    return 0;
+}
+
+/*
+ Prideli 'count' nactenym objektum (kazdy v samostatnem shluku pole 'carr',
+ v poradi ze souboru) huste indexy podle poradi jejich puvodnich
+ identifikatoru z 'id_table'. Tabulku 'id_table' i souradnice v 'coord_pool'
+ preusporada podle novych indexu. Vraci 0, pri chybe (duplicitni
+ identifikatory, alokace) vraci -1.
+*/
+int remap_ids(struct cluster_t *carr, int count)
+{
+    struct id_entry *entries = malloc(sizeof(struct id_entry) * count);
+    float *sorted_pool = NULL;
+
+    if (entries == NULL || (dimension != 2 &&
+        (sorted_pool = malloc(sizeof(float) * count * dimension)) == NULL)){
+      print_error("Alokace pameti se nezdarila.\n");
+      free(entries);
+      return -1;
+    }
+
+    for (int i = 0; i < count; i++){
+      entries[i].id = id_table[i];
+      entries[i].index = i;
+    }
+
+    qsort(entries, count, sizeof(struct id_entry), &id_entry_compar);
+
+    for (int i = 1; i < count; i++){
+      if (entries[i].id == entries[i-1].id){
+        print_error("V souboru byly nalezeny 2 shluky s duplicitnimi ID.\n");
+        free(entries);
+        free(sorted_pool);
+        return -1;
+      }
+    }
+
+    for (int i = 0; i < count; i++){
+      int index = entries[i].index;
+
+      id_table[i] = entries[i].id;
+      carr[index].obj[0].id = i;
+      if (sorted_pool != NULL)
+        memcpy(&sorted_pool[(size_t)i * dimension],
+               &coord_pool[(size_t)index * dimension],
+               sizeof(float) * dimension);
+    }
+
+    if (sorted_pool != NULL){
+      free(coord_pool);
+      coord_pool = sorted_pool;
+    }
+
+    free(entries);
+    return 0;
+}
+
+/*
+ Uvolni tabulky identifikatoru a souradnic vsech objektu.
+*/
+void clear_object_tables()
+{
+    free(id_table);
+    id_table = NULL;
+    free(coord_pool);
+    coord_pool = NULL;
+}
 
 /*
  Ze souboru 'filename' nacte objekty. Pro kazdy objekt vytvori shluk a ulozi
@@ -498,26 +859,47 @@ int load_clusters(const char *filename, struct cluster_t **arr)
       return 0;
     }
 
-    int id, loaded_count = 0;
-    float x, y;
+    long long id;
+    int loaded_count = 0;
 
     int specified_count;
     if ((specified_count = get_object_count_from_first_line(fr)) == -1){
       return 0;
     }
 
+    // cislo radku s prvnim objektem (za radky count=N a pripadne dim=D)
+    int first_line = 2;
+    if ((dimension = get_dimension_from_second_line(fr, &first_line)) == -1){
+      dimension = DEFAULT_DIMENSION;
+      return 0;
+    }
+    select_distance_kernel(dimension);
+
     if ((*arr = malloc(specified_count * sizeof(struct cluster_t))) == NULL){
       print_error("Alokace pameti se nezdarila.\n");
       fclose(fr);
       return 0;
     }
 
-    int ids[specified_count];
+    if ((id_table = malloc(sizeof(long long) * specified_count)) == NULL ||
+        (dimension != 2 &&
+         (coord_pool = malloc(sizeof(float) * specified_count * dimension)) == NULL)){
+      print_error("Alokace pameti se nezdarila.\n");
+      fclose(fr);
+      return 0;
+    }
+
     struct obj_t temp_obj;
-    int f;
+    float xy[2]; // souradnice 2D objektu
+    char id_str[MAX_ID_LENGTH + 1];
     // postupne nacitam objekty ze souboru po jednom radku
-    while (((f = fscanf(fr, "%9d %4f %4f", &id, &x, &y)) == 3)
-           && loaded_count < specified_count) {
+    while (loaded_count < specified_count && fscanf(fr, "%20s", id_str) == 1
+           && str_to_id(id_str, &id)) {
+
+      float *coords = (dimension == 2) ? xy :
+                      &coord_pool[(size_t)loaded_count * dimension];
+      if (!read_coordinates(fr, coords))
+        break;
 
       char c;
       if ((c = getc(fr)) != '\n' && c != EOF && c != '\r'){
@@ -528,29 +910,20 @@ int load_clusters(const char *filename, struct cluster_t **arr)
         return -loaded_count;
       }
 
-      if (x < MIN_COORDINATE || x > MAX_COORDINATE){
-        invalid_coordinate(loaded_count+2, filename, 'X', fr);
-        return -loaded_count;
-      }
-      else if (y < MIN_COORDINATE || y > MAX_COORDINATE){
-        invalid_coordinate(loaded_count+2, filename, 'Y', fr);
-        return -loaded_count;
-      }
-
-      temp_obj.id = id;
-      temp_obj.x = x;
-      temp_obj.y = y;
-
-      ids[loaded_count] = id;
-
-      for (int i = 0; i < loaded_count; i++){
-        if (ids[i] == id){
-          print_error("V souboru byly nalezeny 2 shluky s duplicitnimi ID.\n");
-          fclose(fr);
+      for (int k = 0; k < dimension; k++){
+        if (coords[k] < MIN_COORDINATE || coords[k] > MAX_COORDINATE){
+          invalid_coordinate(loaded_count+first_line, filename, k, fr);
           return -loaded_count;
         }
       }
 
+      // do doby precislovani je indexem objektu jeho poradi v souboru
+      temp_obj.id = loaded_count;
+      temp_obj.x = coords[0];
+      temp_obj.y = coords[1];
+
+      id_table[loaded_count] = id;
+
       // inicializuje prazdny shluk v poli shluku a da do nej dany objekt
       init_cluster(&(*arr)[loaded_count], 0);
       append_cluster(&(*arr)[loaded_count], temp_obj);
@@ -569,6 +942,10 @@ int load_clusters(const char *filename, struct cluster_t **arr)
     }
 
     fclose(fr);
+
+    if (remap_ids(*arr, loaded_count) == -1)
+      return -loaded_count;
+
     return loaded_count;
 }
 
@@ -586,6 +963,349 @@ void print_clusters(struct cluster_t *carr, int narr)
     }
 }
 
+/**********************************************************************/
+/* Metriky kvality shlukovani */
+
+/*
+ Stav vypoctu metrik:
+   in_sample - priznaky objektu ve vzorku indexovane hustym indexem,
+      NULL znamena, ze vzorek tvori vsechny objekty,
+   sample - huste indexy objektu ve vzorku (NULL pro vsechny objekty),
+   sample_size - pocet objektu ve vzorku,
+   pairs, sx, ... - prubezne soucty pro kofeneticky korelacni koeficient
+      pres dvojice (vzdalenost objektu x, vzdalenost slouceni y).
+*/
+struct metrics_t {
+    char *in_sample;
+    int *sample;
+    int sample_size;
+    double pairs, sx, sy, sxx, syy, sxy;
+};
+
+struct metrics_t metrics;
+
+/*
+ Objekty vsech shluku usporadane po shlucich ve tvaru "struct of arrays":
+ souradnice osy k vsech objektu lezi souvisle od coords[k * n], objekty
+ shluku i jsou na pozicich start[i] az start[i+1]-1 a pos[id] je pozice
+ objektu s hustym indexem id.
+*/
+struct metrics_soa_t {
+    int n;
+    float *coords;
+    int *start;
+    int *pos;
+};
+
+// pocet vlaken, ktere muze vypocet metrik pouzit
+static int metrics_threads()
+{
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+// cislo aktualniho vlakna
+static int metrics_thread_num()
+{
+#ifdef _OPENMP
+    return omp_get_thread_num();
+#else
+    return 0;
+#endif
+}
+
+/*
+ Jednoduchy generator pseudonahodnych cisel (LCG) s pevnym pocatecnim
+ stavem, aby byl vzorek objektu pri kazdem spusteni stejny.
+*/
+static unsigned long long metrics_random(unsigned long long *state)
+{
+    *state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return *state >> 33;
+}
+
+/*
+ Pripravi vypocet metrik pro 'count' objektu. Je-li zadana velikost vzorku
+ mensi nez pocet objektu, vybere nahodny vzorek. Vraci 0, pri chybe -1.
+*/
+int metrics_init(int count)
+{
+    memset(&metrics, 0, sizeof(metrics));
+    metrics.sample_size = count;
+
+    if (metrics_sample == 0 || metrics_sample >= count)
+      return 0;
+
+    int *order = malloc(sizeof(int) * count);
+    metrics.in_sample = calloc(count, sizeof(char));
+    if (order == NULL || metrics.in_sample == NULL){
+      print_error("Alokace pameti se nezdarila.\n");
+      free(order);
+      free(metrics.in_sample);
+      metrics.in_sample = NULL;
+      return -1;
+    }
+
+    // castecne Fisher-Yatesovo michani, prvnich 'metrics_sample' je vzorek
+    unsigned long long state = 1;
+    for (int i = 0; i < count; i++)
+      order[i] = i;
+    for (int i = 0; i < metrics_sample; i++){
+      int j = i + metrics_random(&state) % (count - i);
+      int tmp = order[i];
+      order[i] = order[j];
+      order[j] = tmp;
+      metrics.in_sample[order[i]] = 1;
+    }
+
+    metrics.sample = order;
+    metrics.sample_size = metrics_sample;
+    return 0;
+}
+
+/*
+ Uvolni pamet pouzitou pro vypocet metrik.
+*/
+void metrics_clear()
+{
+    free(metrics.in_sample);
+    free(metrics.sample);
+    memset(&metrics, 0, sizeof(metrics));
+}
+
+// zjisti, zda objekt 'o' patri do vzorku
+static inline int metrics_sampled(const struct obj_t *o)
+{
+    return metrics.in_sample == NULL || metrics.in_sample[o->id];
+}
+
+/*
+ Zaznamena slouceni shluku 'c1' a 'c2' ve vzdalenosti 'dist'. Kofeneticka
+ vzdalenost vsech dvojic objektu z 'c1' a 'c2' je prave 'dist', do souctu
+ se tedy pridaji vsechny tyto dvojice objektu ze vzorku.
+*/
+void metrics_record_merge(struct cluster_t *c1, struct cluster_t *c2,
+                          float dist)
+{
+    double pairs = 0, sx = 0, sxx = 0;
+
+#ifdef _OPENMP
+#pragma omp parallel for reduction(+:pairs,sx,sxx) schedule(dynamic, 16)
+#endif
+    for (int i = 0; i < c1->size; i++){
+      if (!metrics_sampled(&c1->obj[i]))
+        continue;
+
+      for (int j = 0; j < c2->size; j++){
+        if (!metrics_sampled(&c2->obj[j]))
+          continue;
+
+        double x = obj_distance(&c1->obj[i], &c2->obj[j]);
+        pairs += 1;
+        sx += x;
+        sxx += x * x;
+      }
+    }
+
+    metrics.pairs += pairs;
+    metrics.sx += sx;
+    metrics.sxx += sxx;
+    metrics.sy += pairs * dist;
+    metrics.syy += pairs * dist * dist;
+    metrics.sxy += sx * dist;
+}
+
+/*
+ Usporada objekty shluku 'carr' do struktury 'soa'. Vraci 0, pri chybe -1.
+*/
+int metrics_build_soa(struct cluster_t *carr, int narr, int count,
+                      struct metrics_soa_t *soa)
+{
+    soa->n = count;
+    soa->coords = malloc(sizeof(float) * count * dimension);
+    soa->start = malloc(sizeof(int) * (narr + 1));
+    soa->pos = malloc(sizeof(int) * count);
+    if (soa->coords == NULL || soa->start == NULL || soa->pos == NULL)
+      return -1;
+
+    int p = 0;
+    for (int i = 0; i < narr; i++){
+      soa->start[i] = p;
+      for (int j = 0; j < carr[i].size; j++, p++){
+        struct obj_t *o = &carr[i].obj[j];
+        soa->pos[o->id] = p;
+
+        if (dimension == 2){
+          soa->coords[p] = o->x;
+          soa->coords[count + p] = o->y;
+        }
+        else {
+          const float *coords = obj_coords(o);
+          for (int k = 0; k < dimension; k++)
+            soa->coords[(size_t)k * count + p] = coords[k];
+        }
+      }
+    }
+    soa->start[narr] = p;
+
+    return 0;
+}
+
+/*
+ Spocita vzdalenosti objektu na pozici 'p' ke vsem objektum ve 'soa' do
+ pole 'dist'. Vnitrni smycky prochazi souvisla pole, lze je vektorizovat.
+*/
+static void metrics_soa_distances(const struct metrics_soa_t *soa, int p,
+                                  float *dist)
+{
+    const int n = soa->n;
+
+    for (int j = 0; j < n; j++)
+      dist[j] = 0;
+
+    for (int k = 0; k < dimension; k++){
+      const float *axis = &soa->coords[(size_t)k * n];
+      const float v = axis[p];
+      for (int j = 0; j < n; j++){
+        float d = axis[j] - v;
+        dist[j] += d * d;
+      }
+    }
+
+    for (int j = 0; j < n; j++)
+      dist[j] = sqrtf(dist[j]);
+}
+
+/*
+ Spocita prumerny silhouette score objektu ze vzorku pro 'narr' shluku
+ v poli 'carr'. Pokud je shluk jen jeden, skore neni definovano a funkce
+ vraci NAN.
+*/
+double metrics_silhouette(struct cluster_t *carr, int narr, int count)
+{
+    if (narr < 2)
+      return NAN;
+
+    struct metrics_soa_t soa = {0, NULL, NULL, NULL};
+    int threads = metrics_threads();
+    float *buffers = NULL;
+    int *cluster_of = malloc(sizeof(int) * count);
+    double sum = 0;
+
+    if (cluster_of != NULL && metrics_build_soa(carr, narr, count, &soa) == 0
+        && (buffers = malloc(sizeof(float) * count * threads)) != NULL){
+
+      for (int i = 0; i < narr; i++)
+        for (int p = soa.start[i]; p < soa.start[i+1]; p++)
+          cluster_of[p] = i;
+
+#ifdef _OPENMP
+#pragma omp parallel for reduction(+:sum) schedule(dynamic, 16)
+#endif
+      for (int s = 0; s < metrics.sample_size; s++){
+        int p = soa.pos[metrics.sample != NULL ? metrics.sample[s] : s];
+        int own = cluster_of[p];
+        float *dist = &buffers[(size_t)metrics_thread_num() * count];
+
+        if (soa.start[own+1] - soa.start[own] == 1)
+          continue; // objekt sam ve shluku ma skore 0
+
+        metrics_soa_distances(&soa, p, dist);
+
+        double a = 0, b = INFINITY;
+        for (int i = 0; i < narr; i++){
+          double cluster_sum = 0;
+          for (int q = soa.start[i]; q < soa.start[i+1]; q++)
+            cluster_sum += dist[q];
+
+          if (i == own)
+            a = cluster_sum / (soa.start[i+1] - soa.start[i] - 1);
+          else if (cluster_sum / (soa.start[i+1] - soa.start[i]) < b)
+            b = cluster_sum / (soa.start[i+1] - soa.start[i]);
+        }
+
+        double max = a > b ? a : b;
+        if (max > 0)
+          sum += (b - a) / max;
+      }
+      sum /= metrics.sample_size;
+    }
+    else {
+      print_error("Alokace pameti se nezdarila.\n");
+      sum = NAN;
+    }
+
+    free(cluster_of);
+    free(buffers);
+    free(soa.coords);
+    free(soa.start);
+    free(soa.pos);
+    return sum;
+}
+
+/*
+ Vraci kofeneticky korelacni koeficient ze souctu nasbiranych behem
+ shlukovani, nebo NAN, pokud neni definovany.
+*/
+double metrics_cophenetic()
+{
+    double n = metrics.pairs;
+    double cov = n * metrics.sxy - metrics.sx * metrics.sy;
+    double var_x = n * metrics.sxx - metrics.sx * metrics.sx;
+    double var_y = n * metrics.syy - metrics.sy * metrics.sy;
+
+    if (n < 2 || var_x <= 0 || var_y <= 0)
+      return NAN;
+
+    return cov / sqrt(var_x * var_y);
+}
+
+/*
+ Vypise metriky kvality shlukovani pro 'narr' vyslednych shluku.
+*/
+void print_metrics(struct cluster_t *carr, int narr, int count)
+{
+    double silhouette = metrics_silhouette(carr, narr, count);
+    double cophenetic = metrics_cophenetic();
+
+    printf("Metrics:\n");
+    if (isnan(silhouette))
+      printf("silhouette: n/a\n");
+    else
+      printf("silhouette: %g\n", silhouette);
+    if (isnan(cophenetic))
+      printf("cophenetic correlation: n/a\n");
+    else
+      printf("cophenetic correlation: %g\n", cophenetic);
+}
+
+/*
+ Slouci shluky na indexech 'c1_index' a 'c2_index' (c1_index < c2_index)
+ vzdalene 'dist' a odstrani shluk 'c2_index' z pole. Vraci novy pocet
+ shluku v poli, pri chybe -1.
+*/
+int merge_neighbours(struct cluster_t *clusters, int size, int c1_index,
+                     int c2_index, float dist)
+{
+    if (metrics_enabled)
+      metrics_record_merge(&clusters[c1_index], &clusters[c2_index], dist);
+
+    int c1_orig_size = clusters[c1_index].size;
+
+    merge_clusters(&clusters[c1_index], &clusters[c2_index]);
+
+    if (clusters[c1_index].size != c1_orig_size + clusters[c2_index].size &&
+        clusters[c2_index].size > 0) {
+      print_error("Nezdarila se alokace pameti.\n");
+      return -1;
+    }
+
+    return remove_cluster(clusters, size, c2_index);
+}
+
 /*
  Funkce shlukujici shluky, dokud neni jejich pocet dostatecne zredukovany.
 */
@@ -596,68 +1316,435 @@ int clustering(struct cluster_t *clusters, int size, int final_size)
       return -1;
     }
 
-    int c1_orig_size, c1_index, c2_index;
+    int c1_index, c2_index;
+    float dist;
 
     while (size > final_size) {
-      find_neighbours(clusters, size, &c1_index, &c2_index);
+      // nejblizsi shluky jsou uz prilis vzdalene, dalsi slucovani nema smysl
+      if ((dist = find_neighbours(clusters, size, &c1_index, &c2_index))
+          > max_merge_distance)
+        break;
+
+      if ((size = merge_neighbours(clusters, size, c1_index, c2_index,
+                                   dist)) == -1)
+        return -1;
+    }
 
-      c1_orig_size = clusters[c1_index].size;
+    return size;
+}
 
-      merge_clusters(&clusters[c1_index], &clusters[c2_index]);
+/**********************************************************************/
+/* Hledani nejblizsich shluku rozdelene mezi vice procesu */
 
-      if (clusters[c1_index].size != c1_orig_size + clusters[c2_index].size &&
-          clusters[c2_index].size > 0) {
-        print_error("Nezdarila se alokace pameti.\n");
-        return -1;
+/*
+ Koordinator (hlavni proces) drzi pole shluku jako pri clustering(),
+ vzdalenosti shluku jsou ale ulozene ve sdilene matici n x n indexovane
+ sloty - puvodnimi indexy shluku. Sloucenim slotu c1 a c2 zanika slot c2,
+ poradi zivych slotu tedy odpovida poradi shluku v poli.
+
+ Kazdy pomocny proces vlastni souvisly blok radku matice. Radky sam
+ vyplni, takze je jadro (politika first-touch) umisti do pameti uzlu NUMA,
+ na kterem proces bezi. V kazdem kole posle koordinatorovi nejblizsi
+ dvojici ve svych radcich, koordinator vybere celkove nejblizsi dvojici,
+ slouci ji a rozesle prikaz ke slouceni. Procesy pak prepocitaji
+ vzdalenosti ve svych radcich: u metod --min a --max presne
+ Lance-Williamsovym vzorcem, u --avg slouci shluky ve sve kopii pole
+ stejne jako merge_clusters() a vzdalenost spocitaji znovu funkci
+ cluster_distance(). Lance-Williamsuv vazeny prumer se totiz zaokrouhluje
+ jinak nez prumer pocitany v cluster_distance() a shodne vzdalenosti by se
+ pak mohly lisit.
+
+ Matice tak obsahuje stejne hodnoty, jake pocita find_neighbours(). Dvojice
+ se porovnavaji ostrou nerovnosti v poradi radku a sloupcu a bloky radku
+ jsou serazene podle pracovnich procesu, pri shode vzdalenosti tak vyhrava
+ stejna dvojice jako ve find_neighbours().
+*/
+
+// prikaz koordinatora: slouceni slotu c1 a c2, c1 == -1 ukonci proces
+struct shard_cmd {
+    int c1;
+    int c2;
+};
+
+// nejblizsi dvojice slotu v radcich procesu, i == -1 pokud zadna neni
+struct shard_best {
+    float dist;
+    int i;
+    int j;
+};
+
+/*
+ Vraci prvni radek bloku pomocneho procesu 'w' z 'workers'. Bloky jsou
+ zvolene tak, aby kazdy obsahoval priblizne stejny pocet dvojic j > i.
+*/
+static int shard_first_row(int n, int workers, int w)
+{
+    double total = (double)n * (n - 1) / 2;
+    double target = total * w / workers, area = 0;
+    int row = 0;
+
+    if (w == workers) // posledni blok konci poslednim radkem matice
+      return n;
+
+    while (row < n && area < target){
+      area += n - 1 - row;
+      row++;
+    }
+
+    return row;
+}
+
+/*
+ Vraci vzdalenost sloucenych shluku k jinemu shluku, od nejz byly vzdalene
+ 'd1' a 'd2' (Lance-Williamsuv vzorec, pouze pro metody MIN a MAX).
+*/
+static float shard_linkage(float d1, float d2)
+{
+    if (premium_case == MIN)
+      return d1 < d2 ? d1 : d2;
+    return d1 > d2 ? d1 : d2;
+}
+
+/*
+ Vraci vzdalenost shluku ve slotech 'i' a 'j' tak, jak ji pocita
+ find_neighbours() - shluk s mensim indexem je vzdy prvni.
+*/
+static float shard_distance(struct cluster_t *carr, int i, int j)
+{
+    return i < j ? cluster_distance(&carr[i], &carr[j])
+                 : cluster_distance(&carr[j], &carr[i]);
+}
+
+/*
+ Telo pomocneho procesu vlastniciho radky 'lo' az 'hi'-1 sdilene matice.
+ Pole shluku 'carr' je po fork() vlastni kopii procesu. Vraci navratovy
+ kod procesu.
+*/
+static int shard_worker(struct cluster_t *carr, int n, float *matrix,
+                        int lo, int hi, int cmd_fd, int res_fd)
+{
+    char *active = malloc(n);
+    if (active == NULL)
+      return EXIT_FAILURE;
+
+    for (int k = 0; k < n; k++)
+      active[k] = 1;
+
+    for (int i = lo; i < hi; i++)
+      for (int j = 0; j < n; j++)
+        matrix[(size_t)i * n + j] = (i == j) ? 0 : shard_distance(carr, i, j);
+
+    struct shard_cmd cmd;
+    do {
+      struct shard_best best = {0, -1, -1};
+
+      for (int i = lo; i < hi; i++){
+        if (!active[i])
+          continue;
+
+        const float *row = &matrix[(size_t)i * n];
+        for (int j = i + 1; j < n; j++){
+          if (active[j] && (row[j] < best.dist || best.i == -1)){
+            best.dist = row[j];
+            best.i = i;
+            best.j = j;
+          }
+        }
+      }
+
+      if (write(res_fd, &best, sizeof(best)) != sizeof(best) ||
+          read(cmd_fd, &cmd, sizeof(cmd)) != sizeof(cmd))
+        return EXIT_FAILURE;
+
+      if (cmd.c1 == -1)
+        break;
+
+      active[cmd.c2] = 0;
+
+      if (premium_case == AVG){
+        int c1_orig_size = carr[cmd.c1].size;
+
+        merge_clusters(&carr[cmd.c1], &carr[cmd.c2]);
+        if (carr[cmd.c1].size != c1_orig_size + carr[cmd.c2].size)
+          return EXIT_FAILURE;
+        clear_cluster(&carr[cmd.c2]);
+
+        for (int k = lo; k < hi; k++){
+          if (!active[k])
+            continue;
+
+          float *row = &matrix[(size_t)k * n];
+          if (k != cmd.c1){
+            row[cmd.c1] = shard_distance(carr, k, cmd.c1);
+            continue;
+          }
+
+          for (int j = 0; j < n; j++)
+            if (active[j] && j != cmd.c1)
+              row[j] = shard_distance(carr, cmd.c1, j);
+        }
+        continue;
+      }
+
+      const float *row_c2 = &matrix[(size_t)cmd.c2 * n];
+      for (int k = lo; k < hi; k++){
+        if (!active[k])
+          continue;
+
+        float *row = &matrix[(size_t)k * n];
+        if (k != cmd.c1){
+          row[cmd.c1] = shard_linkage(row[cmd.c1], row[cmd.c2]);
+          continue;
+        }
+
+        for (int j = 0; j < n; j++)
+          if (active[j] && j != cmd.c1)
+            row[j] = shard_linkage(row[j], row_c2[j]);
+      }
+    } while (1);
+
+    free(active);
+    return EXIT_SUCCESS;
+}
+
+/*
+ Ukonci vsechny spustene pomocne procesy a uvolni jejich prostredky.
+*/
+static void shard_stop(int started, pid_t *pids, int *cmd_fd, int *res_fd)
+{
+    struct shard_cmd stop = {-1, -1};
+
+    for (int w = 0; w < started; w++){
+      if (write(cmd_fd[w], &stop, sizeof(stop)) != sizeof(stop))
+        kill(pids[w], SIGTERM);
+      close(cmd_fd[w]);
+      close(res_fd[w]);
+    }
+    for (int w = 0; w < started; w++)
+      waitpid(pids[w], NULL, 0);
+
+    free(pids);
+    free(cmd_fd);
+    free(res_fd);
+}
+
+/*
+ Funkce shlukujici shluky stejne jako clustering(), nejblizsi shluky ale
+ hleda 'shard_workers' pomocnych procesu nad sdilenou matici vzdalenosti.
+*/
+int clustering_sharded(struct cluster_t *clusters, int size, int final_size)
+{
+    if (final_size > size){
+      print_error("Zadany pozadovany pocet shluku je vetsi nez puvodni pocet.\n");
+      return -1;
+    }
+    if (size <= final_size)
+      return size;
+
+    const int n = size, workers = shard_workers;
+    size_t matrix_size = sizeof(float) * n * n;
+    float *matrix = mmap(NULL, matrix_size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    pid_t *pids = malloc(sizeof(pid_t) * workers);
+    int *cmd_fd = malloc(sizeof(int) * workers);
+    int *res_fd = malloc(sizeof(int) * workers);
+    int *slots = malloc(sizeof(int) * n); // slot shluku na danem indexu pole
+
+    if (matrix == MAP_FAILED || pids == NULL || cmd_fd == NULL
+        || res_fd == NULL || slots == NULL){
+      print_error("Alokace pameti se nezdarila.\n");
+      if (matrix != MAP_FAILED)
+        munmap(matrix, matrix_size);
+      free(pids);
+      free(cmd_fd);
+      free(res_fd);
+      free(slots);
+      return -1;
+    }
+
+    for (int i = 0; i < n; i++)
+      slots[i] = i;
+
+    fflush(stdout);
+    int started = 0;
+    for (; started < workers; started++){
+      int cmd_pipe[2], res_pipe[2];
+      if (pipe(cmd_pipe) == -1)
+        break;
+      if (pipe(res_pipe) == -1){
+        close(cmd_pipe[0]);
+        close(cmd_pipe[1]);
+        break;
+      }
+
+      pid_t pid = fork();
+      if (pid == 0){
+        close(cmd_pipe[1]);
+        close(res_pipe[0]);
+        _exit(shard_worker(clusters, n, matrix,
+                           shard_first_row(n, workers, started),
+                           shard_first_row(n, workers, started + 1),
+                           cmd_pipe[0], res_pipe[1]));
+      }
+
+      close(cmd_pipe[0]);
+      close(res_pipe[1]);
+      if (pid == -1){
+        close(cmd_pipe[1]);
+        close(res_pipe[0]);
+        break;
+      }
+
+      pids[started] = pid;
+      cmd_fd[started] = cmd_pipe[1];
+      res_fd[started] = res_pipe[0];
+    }
+
+    if (started < workers){
+      print_error("Nepodarilo se spustit pomocne procesy.\n");
+      size = -1;
+    }
+
+    while (size > final_size){
+      struct shard_best best = {0, -1, -1}, local;
+
+      for (int w = 0; w < workers; w++){
+        if (read(res_fd[w], &local, sizeof(local)) != sizeof(local)){
+          print_error("Pomocny proces neocekavane skoncil.\n");
+          best.i = -2;
+          break;
+        }
+        if (local.i != -1 && (local.dist < best.dist || best.i == -1))
+          best = local;
+      }
+
+      if (best.i == -2){
+        size = -1;
+        break;
+      }
+      // nejblizsi shluky jsou uz prilis vzdalene, dalsi slucovani nema smysl
+      if (best.i == -1 || best.dist > max_merge_distance)
+        break;
+
+      int c1_index = 0, c2_index;
+      while (slots[c1_index] != best.i)
+        c1_index++;
+      c2_index = c1_index + 1;
+      while (slots[c2_index] != best.j)
+        c2_index++;
+
+      if (merge_neighbours(clusters, size, c1_index, c2_index,
+                           best.dist) == -1){
+        size = -1;
+        break;
       }
+      memmove(&slots[c2_index], &slots[c2_index + 1],
+              sizeof(int) * (size - c2_index - 1));
+      size--;
 
-      size = remove_cluster(clusters, size, c2_index);
+      if (size == final_size)
+        break;
+
+      struct shard_cmd cmd = {best.i, best.j};
+      for (int w = 0; w < workers; w++){
+        if (write(cmd_fd[w], &cmd, sizeof(cmd)) != sizeof(cmd)){
+          print_error("Pomocny proces neocekavane skoncil.\n");
+          size = -1;
+          break;
+        }
+      }
     }
 
+    shard_stop(started, pids, cmd_fd, res_fd);
+    munmap(matrix, matrix_size);
+    free(slots);
     return size;
 }
 
+/*
+ Funkce, ktera prevadi retezec na nezaporne desetinne cislo (float).
+ V pripade chyby vraci -1.
+*/
+float str_to_nonnegative_float(const char *s)
+{
+    char *endptr;
+    float num = strtof(s, &endptr);
+
+    if (endptr != s && endptr[0] == '\0' && num >= 0 && !isnan(num))
+      return num;
+    else
+      return -1;
+}
+
 /*
  Funkce kontrolujici spravnost zadanych argumentu.
 */
 int arg_check(const int argc, const char *argv[])
 {
     int cluster_required_count;
+    // argumenty N a METHOD bez pripadneho --max-merge-distance D
+    const char *args[2];
+    int args_count = 0;
+
     if (argc == 1){
       print_error("Nezadan zadny argument.\n");
       return -1;
     }
-    else if (argc == 2) // pokud nebyl zadan cilovy pocet shluku
-      cluster_required_count = DEFAULT_CLUSTER_COUNT;
-    else if (argc == 3){
-      if (!(cluster_required_count = str_to_int(argv[2]))
-          || cluster_required_count <= 0){
-        print_error("Nastaveny pocet shluku musi byt nenulove cislo.\n");
+
+    for (int i = 2; i < argc; i++){
+      if (strcmp(argv[i], "--metrics") == 0)
+        metrics_enabled = 1;
+      else if (strcmp(argv[i], "--metrics-sample") == 0){
+        if (i + 1 == argc || (metrics_sample = str_to_int(argv[++i])) <= 0){
+          print_error("Velikost vzorku pro metriky musi byt kladne cislo.\n");
+          return -1;
+        }
+        metrics_enabled = 1;
+      }
+      else if (strcmp(argv[i], "--workers") == 0){
+        if (i + 1 == argc || (shard_workers = str_to_int(argv[++i])) <= 0){
+          print_error("Pocet pomocnych procesu musi byt kladne cislo.\n");
+          return -1;
+        }
+      }
+      else if (strcmp(argv[i], "--max-merge-distance") == 0){
+        if (i + 1 == argc
+            || (max_merge_distance = str_to_nonnegative_float(argv[++i])) < 0){
+          print_error("Maximalni vzdalenost slucovanych shluku musi byt "
+                      "nezaporne cislo.\n");
+          return -1;
+        }
+      }
+      else if (args_count < 2)
+        args[args_count++] = argv[i];
+      else {
+        print_error("Zadan nadbytecny pocet argumentu.\n");
         return -1;
       }
     }
-    else if (argc == 4){
-      if (!(cluster_required_count = str_to_int(argv[2]))
+
+    if (args_count == 0) // pokud nebyl zadan cilovy pocet shluku
+      cluster_required_count = DEFAULT_CLUSTER_COUNT;
+    else {
+      if (!(cluster_required_count = str_to_int(args[0]))
           || cluster_required_count <= 0){
         print_error("Nastaveny pocet shluku musi byt nenulove cislo.\n");
         return -1;
       }
+    }
 
-      if (strcmp(argv[3], "--avg") == 0)
+    if (args_count == 2){
+      if (strcmp(args[1], "--avg") == 0)
         premium_case = AVG;
-      else if (strcmp(argv[3], "--min") == 0)
+      else if (strcmp(args[1], "--min") == 0)
         premium_case = MIN;
-      else if (strcmp(argv[3], "--max") == 0)
+      else if (strcmp(args[1], "--max") == 0)
         premium_case = MAX;
       else{
         print_error("Zadan neplatny argument metody shlukovani.\n");
         return -1;
       }
     }
-    else {
-      print_error("Zadan nadbytecny pocet argumentu.\n");
-      return -1;
-    }
 
     return cluster_required_count;
 }
@@ -675,16 +1762,34 @@ int main(const int argc, const char *argv[])
     int loaded; // pocet nactenych objektu ze souboru
     if ((loaded = load_clusters(argv[1], &clusters)) <= 0){
       clear_all_clusters(clusters, -loaded);
+      clear_object_tables();
       return EXIT_FAILURE;
     }
 
-    if ((final_size = clustering(clusters, loaded, final_size)) == -1){
+    if (metrics_enabled && metrics_init(loaded) == -1){
+      clear_all_clusters(clusters, loaded);
+      clear_object_tables();
+      return EXIT_FAILURE;
+    }
+
+    if (shard_workers > 0)
+      final_size = clustering_sharded(clusters, loaded, final_size);
+    else
+      final_size = clustering(clusters, loaded, final_size);
+
+    if (final_size == -1){
       clear_all_clusters(clusters, loaded);
+      clear_object_tables();
+      metrics_clear();
       print_help();
       return EXIT_FAILURE;
     }
 
     print_clusters(clusters, final_size);
+    if (metrics_enabled)
+      print_metrics(clusters, final_size, loaded);
+    metrics_clear();
     clear_all_clusters(clusters, final_size);
+    clear_object_tables();
     return EXIT_SUCCESS;
 }
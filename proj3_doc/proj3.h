@@ -11,7 +11,11 @@
  * @brief Structure representing an object.
  */
 struct obj_t {
-    /** Numeric identificator of an object. */
+    /**
+     * Dense index of an object (0..N-1) assigned in the order of the
+     *    original identificators, which are kept in a side table and
+     *    used only for printing.
+     */
     int id;
 
     /** x coordinate of an object. */
@@ -165,6 +169,9 @@ int remove_cluster(struct cluster_t *carr, int narr, int idx);
 /**
  * @brief Counts Euclidean distance between two objects.
  *
+ * 2D objects are handled directly, objects with more dimensions use
+ *    the kernel chosen by select_distance_kernel().
+ *
  * @param o1 Pointer to 1st object
  * @param o2 Pointer to 2nd object
  *
@@ -189,9 +196,28 @@ float obj_distance(struct obj_t *o1, struct obj_t *o2);
  */
 float cluster_distance(struct cluster_t *c1, struct cluster_t *c2);
 
+/**
+ * @brief Counts distance of two clusters, giving up once it exceeds a bound.
+ *
+ * @param c1 Pointer to 1st cluster
+ * @param c2 Pointer to 2nd cluster
+ * @param bound Distance above which the exact value is not needed.
+ *
+ * @pre 'c1' and 'c2' both != NULL.
+ * @pre Size of both 'c1' and 'c2' >= 0.
+ *
+ * @return Distance of clusters 'c1' and 'c2', or some value greater than
+ *          'bound' if the distance is greater than 'bound'.
+ */
+float cluster_distance_bounded(struct cluster_t *c1, struct cluster_t *c2,
+                               float bound);
+
 /**
  * @brief Finds two nearest clusters in cluster array 'carr'.
  *
+ * Pairs which are certainly farther than the best pair found so far (or
+ *    than the maximum merge distance) are not evaluated completely.
+ *
  * @param carr Pointer to array of clusters.
  * @param narr Number of clusters in array.
  * @param c1 Pointer to index of the first nearest found cluster.
@@ -200,8 +226,11 @@ float cluster_distance(struct cluster_t *c1, struct cluster_t *c2);
  * @pre narr >= 0
  *
  * @post Indexes of two nearest clusters will be stored in 'c1' and 'c2'.
+ *
+ * @return Distance of the two nearest clusters, or some value greater than
+ *          the maximum merge distance if no pair is close enough.
  */
-void find_neighbours(struct cluster_t *carr, int narr, int *c1, int *c2);
+float find_neighbours(struct cluster_t *carr, int narr, int *c1, int *c2);
 
 /**
  * @brief Loads objects from a file and creates clusters for them.
@@ -251,12 +280,133 @@ void clear_all_clusters(struct cluster_t *carr, int narr);
  *
  * @pre final_size < size
  *
- * @post Count of clusters will be reduced to desired count.
+ * @post Count of clusters will be reduced to desired count, or less
+ *          if the nearest clusters get farther than the maximum merge
+ *          distance (argument --max-merge-distance).
  *
  * @return New size of cluster array.
  */
 int clustering(struct cluster_t *clusters, int size, int final_size);
 
+/**
+ * @brief Merges two nearest clusters and removes the second one from array.
+ *
+ * @param clusters Pointer to array of clusters.
+ * @param size Count of clusters in array.
+ * @param c1_index Index of the first cluster, which will hold the result.
+ * @param c2_index Index of the second cluster, c1_index < c2_index.
+ * @param dist Distance of the merged clusters.
+ *
+ * @return New size of cluster array, -1 on allocation error.
+ */
+int merge_neighbours(struct cluster_t *clusters, int size, int c1_index,
+                     int c2_index, float dist);
+
+/**
+ * @brief Reduces number of clusters using several worker processes.
+ *
+ * Distances of clusters are kept in a matrix in shared memory, each
+ *    worker process owns a block of its rows, fills them (so they end up in
+ *    memory of its NUMA node) and reports the nearest pair among them every
+ *    round. The main process applies the merge, workers update their rows:
+ *    by the Lance-Williams formula for --min and --max, where it is exact,
+ *    and for --avg by merging the clusters in their own copy of the array
+ *    and recomputing the distances by cluster_distance(), so the matrix
+ *    holds the same values as find_neighbours() computes. Ties are broken
+ *    as in find_neighbours(), the result is the same as of clustering().
+ *
+ * @param clusters Pointer to array of clusters to be reduced.
+ * @param size Original size of cluster array (count of clusters in it).
+ * @param final_size Desired final size of cluster array.
+ *
+ * @pre final_size < size
+ *
+ * @return New size of cluster array, -1 on error.
+ */
+int clustering_sharded(struct cluster_t *clusters, int size, int final_size);
+
+/**
+ * @}
+ */
+
+/**
+ * @defgroup metrics Clustering quality metrics
+ *
+ * The silhouette score and the cophenetic sums are computed in parallel
+ *    with OpenMP only when the program is compiled with -fopenmp, e.g.
+ *    gcc -std=c99 -Wall -Wextra -Werror -DNDEBUG -fopenmp proj3.c -o proj3 -lm.
+ *    Without it the pragmas are ignored and the metrics are computed
+ *    serially in one thread (the results differ only by the rounding
+ *    of the sums).
+ * @{
+ */
+
+/**
+ * @brief Prepares computation of metrics for 'count' objects.
+ *
+ * If the sample size (argument --metrics-sample) is smaller than the count
+ *    of objects, a pseudorandom sample with a fixed seed is chosen.
+ *
+ * @param count Count of loaded objects.
+ *
+ * @return 0 on success, -1 on allocation error.
+ */
+int metrics_init(int count);
+
+/**
+ * @brief Frees memory used for computation of metrics.
+ */
+void metrics_clear();
+
+/**
+ * @brief Records merge of clusters 'c1' and 'c2' for cophenetic correlation.
+ *
+ * The cophenetic distance of every pair of sampled objects from 'c1' and
+ *    'c2' is 'dist', the pairs are added to running sums.
+ *
+ * @param c1 Pointer to 1st merged cluster.
+ * @param c2 Pointer to 2nd merged cluster.
+ * @param dist Distance at which the clusters are merged.
+ */
+void metrics_record_merge(struct cluster_t *c1, struct cluster_t *c2,
+                          float dist);
+
+/**
+ * @brief Computes mean silhouette score of sampled objects.
+ *
+ * Objects are first laid out cluster by cluster as a structure of arrays,
+ *    distances from one object to all others are then computed with
+ *    vectorisable loops, objects are processed in parallel with OpenMP
+ *    when it is enabled at compile time.
+ *
+ * @param carr Pointer to array of final clusters.
+ * @param narr Number of clusters in array.
+ * @param count Count of all objects.
+ *
+ * @return Mean silhouette score, NAN if there is only one cluster.
+ */
+double metrics_silhouette(struct cluster_t *carr, int narr, int count);
+
+/**
+ * @brief Computes cophenetic correlation coefficient of recorded merges.
+ *
+ * Only pairs of objects which were merged during clustering have
+ *    a cophenetic distance, so for N > 1 the coefficient covers pairs
+ *    within the final clusters.
+ *
+ * @return Cophenetic correlation coefficient, NAN if it is not defined.
+ */
+double metrics_cophenetic();
+
+/**
+ * @brief Prints clustering quality metrics to stdout.
+ *
+ * @param carr Pointer to array of final clusters.
+ * @param narr Number of clusters in array.
+ * @param count Count of all objects.
+ */
+void print_metrics(struct cluster_t *carr, int narr, int count);
+
 /**
  * @}
  */
@@ -290,17 +440,89 @@ int arg_check(const int argc, const char *argv[]);
  */
 int get_object_count_from_first_line(FILE *fr);
 
+/**
+ * @brief Gets dimension of objects from the optional "dim=D" line.
+ *
+ * @param fr Pointer to open file with object definitions.
+ * @param line Pointer to number of the first object line, incremented
+ *          if the "dim=D" line is present.
+ *
+ * @pre The first line of the file has already been read.
+ *
+ * @return Dimension of objects (2 if the line is missing), -1 on error.
+ */
+int get_dimension_from_second_line(FILE *fr, int *line);
+
+/**
+ * @brief Reads all coordinates of one object from the input file.
+ *
+ * @param fr Pointer to open file with object definitions.
+ * @param coords Array for at least 'dimension' coordinates.
+ *
+ * @return 1 if all coordinates were read, 0 otherwise.
+ */
+int read_coordinates(FILE *fr, float *coords);
+
+/**
+ * @brief Chooses distance computation for objects with 'dim' dimensions.
+ *
+ * Dimensions 3, 4, 8 and 16 get kernels specialised at compile time,
+ *    other values use a generic loop.
+ *
+ * @param dim Dimension of objects.
+ */
+void select_distance_kernel(int dim);
+
 /**
  * @brief Informs user about wrong object coordinate in the input file.
  *
  * @param line Number of line which contains an invalid coordinate.
  * @param filename Name of file from which the program reads.
- * @param c Character X/Y depending on which coordinate on the line is invalid.
+ * @param axis Index of the invalid coordinate on the line (0 = X, 1 = Y, ...).
  * @param fr Pointer to open file.
  *
  * @post An error message will be displayed and the program will end.
  */
-void invalid_coordinate(int line, const char *filename, char c, FILE *fr);
+void invalid_coordinate(int line, const char *filename, int axis, FILE *fr);
+
+/**
+ * @brief Converts string to 64-bit object identificator.
+ *
+ * @param s String to be converted to a number.
+ * @param id Pointer to the converted identificator.
+ *
+ * @return 1 if the string is a valid 64-bit integer number, 0 otherwise.
+ */
+int str_to_id(const char *s, long long *id);
+
+/**
+ * @brief Assigns dense indexes to freshly loaded objects.
+ *
+ * Objects get indexes 0..count-1 in the order of their original
+ *    identificators, the table of identificators and the pool of
+ *    coordinates are reordered accordingly.
+ *
+ * @param carr Pointer to array of single-object clusters in file order.
+ * @param count Number of clusters in array.
+ *
+ * @return 0 on success, -1 on duplicate identificators or allocation error.
+ */
+int remap_ids(struct cluster_t *carr, int count);
+
+/**
+ * @brief Frees tables of original identificators and coordinates.
+ */
+void clear_object_tables();
+
+/**
+ * @brief Converts string to non-negative floating-point number.
+ *
+ * @param s String to be converted to a number.
+ *
+ * @return Input string as a number, -1 if it is not a valid non-negative
+ *          number.
+ */
+float str_to_nonnegative_float(const char *s);
 
 /**
  * @brief Converts string to integer number.